@@ -1,6 +1,9 @@
 #pragma once
 #include <SimpleHTTP/types.h>
 
+#include <array>
+#include <optional>
+#include <span>
 #include <vector>
 #include <string_view>
 #include <string>
@@ -50,6 +53,94 @@ private:
     StringRange m_Fragment;
 };
 
+/// @brief Non-owning view of a request target, in origin-form or absolute-form, delimited without allocating.
+/// The whole target is validated on construction, but only the path is split, into an inline array of segments;
+/// the query and fragment are located when asked for.
+/// @note The viewed string must outlive the view. Empty segments are skipped and dot segments are not resolved,
+/// see removeDotSegments.
+class URIView
+{
+public:
+    /// @brief Number of segments whose bounds are kept, the following ones are found again when accessed.
+    static constexpr u64 INLINE_SEGMENT_COUNT = 16;
+
+    URIView() = default;
+    /// @throw std::runtime_error if the target is not a valid URI.
+    explicit URIView(std::string_view target);
+
+    std::string_view getScheme() const;
+    std::string_view getAuthority() const;
+    std::string_view getPath() const;
+
+    u64 getSegmentCount() const;
+    std::string_view getSegment(u64 index) const;
+    std::vector<std::string_view> getSegments() const;
+
+    /// @brief Returns the part of the path from its first segment to its last one.
+    std::string_view getSegmentsSection() const;
+
+    std::string_view getQuery() const;
+    std::string_view getFragment() const;
+
+    std::string_view getRaw() const;
+    std::string toString() const;
+private:
+    using Range = std::pair<u32, u32>;
+
+    std::string_view m_Raw;
+    u32 m_SchemeEnd = 0;
+    u32 m_AuthorityBegin = 0;
+    u32 m_PathBegin = 0;
+    u32 m_PathEnd = 0;
+    u32 m_SegmentCount = 0;
+    Range m_SegmentsSection{};
+    std::array<Range, INLINE_SEGMENT_COUNT> m_Segments{};
+};
+
+/// @brief Decodes the percent escapes of a path into the buffer, dropping its empty segments, for mapping it
+/// to the filesystem.
+/// @param buffer At least as large as the path, which it may not overlap.
+/// @return The length of the decoded path, or nullopt if an escape is malformed, if a segment is "." or "..",
+/// or if a character would change the meaning of the path, such as an encoded '/', a '\\', a ':' or a control character.
+std::optional<u64> decodePath(std::string_view path, std::span<char> buffer);
+
+/// @brief Resolves the "." and ".." segments of the path of a request target in place.
+/// @return The length of the target once resolved, which is never longer.
+u64 removeDotSegments(char* target, u64 length);
+
+/// @brief Named values captured from the segments of a path, stored inline so that capturing them allocates nothing.
+/// @note The names and values are views, the values being left percent-encoded.
+class PathParameters
+{
+public:
+    using Parameter = std::pair<std::string_view, std::string_view>;
+
+    static constexpr u64 CAPACITY = 8;
+
+    /// @return false if the set is full.
+    bool add(std::string_view name, std::string_view value);
+
+    /// @brief Returns the value of the parameter, or an empty view if it was not captured.
+    std::string_view get(std::string_view name) const;
+    bool contains(std::string_view name) const;
+
+    u64 size() const;
+    bool empty() const;
+
+    void clear();
+
+    inline const Parameter* begin() const {
+        return m_Parameters.data();
+    }
+
+    inline const Parameter* end() const {
+        return m_Parameters.data() + m_Size;
+    }
+private:
+    std::array<Parameter, CAPACITY> m_Parameters{};
+    u64 m_Size = 0;
+};
+
 }
 
 template <>
@@ -62,6 +153,16 @@ struct std::formatter<simpleHTTP::URI> : std::formatter<std::string>
     formatter() = default;
 };
 
+template <>
+struct std::formatter<simpleHTTP::URIView> : std::formatter<std::string>
+{
+    auto format(const simpleHTTP::URIView& uri, format_context& ctx) const {
+        return formatter<string>::format(uri.toString(), ctx);
+    }
+
+    formatter() = default;
+};
+
 template <>
 struct std::less<simpleHTTP::URI>
 {
@@ -83,3 +184,4 @@ struct std::less<simpleHTTP::URI>
 };
 
 std::filesystem::path operator/(const std::filesystem::path& path, const simpleHTTP::URI& uri);
+std::filesystem::path operator/(const std::filesystem::path& path, const simpleHTTP::URIView& uri);
@@ -0,0 +1,64 @@
+#pragma once
+#include <SimpleHTTP/types.h>
+
+#include <atomic>
+
+namespace simpleHTTP {
+
+/// @brief Bounds the memory held at once by the buffered requests and responses of a server.
+class MemoryBudget
+{
+public:
+    /// @note A limit of 0 means no limit, the usage is still measured.
+    explicit MemoryBudget(u64 limit);
+    MemoryBudget(const MemoryBudget&) = delete;
+
+    /// @brief Accounts the given size, unless it would exceed the limit.
+    bool tryReserve(u64 size);
+
+    /// @brief Accounts the given size even if it exceeds the limit.
+    /// @note Used for memory that can no longer be refused, so that the next requests are.
+    void reserve(u64 size);
+
+    void release(u64 size);
+
+    u64 getUsage() const;
+    u64 getLimit() const;
+
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+private:
+    const u64 m_Limit;
+    std::atomic<u64> m_Usage = 0;
+};
+
+/// @brief Memory accounted against a MemoryBudget, released on destruction.
+class MemoryReservation
+{
+public:
+    MemoryReservation() = default;
+    /// @param budget If null, nothing is accounted.
+    explicit MemoryReservation(MemoryBudget* budget);
+    MemoryReservation(const MemoryReservation&) = delete;
+    MemoryReservation(MemoryReservation&& other) noexcept;
+
+    /// @brief Accounts the given size, unless it would exceed the limit of the budget.
+    bool tryGrow(u64 size);
+
+    /// @brief Accounts the given size even if it exceeds the limit of the budget.
+    void grow(u64 size);
+
+    /// @brief Releases all the accounted memory, the reservation can then grow again.
+    void clear();
+
+    u64 size() const;
+
+    MemoryReservation& operator=(const MemoryReservation&) = delete;
+    MemoryReservation& operator=(MemoryReservation&& other) noexcept;
+
+    ~MemoryReservation();
+private:
+    MemoryBudget* m_Budget = nullptr;
+    u64 m_Size = 0;
+};
+
+} // namespace simpleHTTP
@@ -0,0 +1,86 @@
+#pragma once
+#include <SimpleHTTP/types.h>
+
+namespace simpleHTTP {
+
+class ThreadBlockCache;
+
+/// @brief Memory block borrowed from the BufferPool and returned to it on destruction.
+/// @note It is move-only, so that a block is never copied implicitly.
+class Buffer
+{
+public:
+    Buffer() = default;
+    Buffer(const Buffer&) = delete;
+    Buffer(Buffer&& other) noexcept;
+
+    inline u8* data() const {
+        return m_Data;
+    }
+
+    inline u64 size() const {
+        return m_Size;
+    }
+
+    inline explicit operator bool() const {
+        return m_Data != nullptr;
+    }
+
+    Buffer& operator=(const Buffer&) = delete;
+    Buffer& operator=(Buffer&& other) noexcept;
+
+    ~Buffer();
+
+    friend class BufferPool;
+private:
+    u8* m_Data = nullptr;
+    u64 m_Size = 0;
+
+    Buffer(u8* data, u64 size);
+};
+
+/// @note The memory of the pool only grows, unless BufferPool::trim is called.
+struct BufferPoolSettings
+{
+    /// @brief Back the slabs with huge pages when the system allows it.
+    bool useHugePages = false;
+    /// @brief Bytes of each size class kept by every thread before returning blocks to the shared lists.
+    u64 threadCacheSize = 0x40000;
+};
+
+/// @brief Process-wide pool of memory blocks, grouped in power of two size classes.
+/// Blocks are carved from large slabs, and each thread keeps a small cache of released blocks, so that
+/// steady-state serving performs no allocation.
+/// @note The pool only grows to its peak usage: slabs are returned to the system by trim alone.
+/// Requests larger than MAX_BLOCK_SIZE are served directly by the heap.
+class BufferPool
+{
+public:
+    static constexpr u64 MIN_BLOCK_SIZE = 0x1000;
+    static constexpr u64 MAX_BLOCK_SIZE = 0x100000;
+    static constexpr u64 SLAB_SIZE = 0x200000;
+
+    BufferPool() = delete;
+
+    /// @brief Returns a block of at least the given size.
+    static Buffer acquire(u64 size);
+
+    /// @note It only affects the slabs and thread caches created afterwards.
+    static void configure(const BufferPoolSettings& settings);
+
+    /// @brief Returns to the system the slabs whose blocks are all back in the shared lists,
+    /// for instance after a peak of load.
+    /// @note Blocks kept by the thread caches are not returned, so neither are their slabs.
+    /// @return The number of slabs freed.
+    static u64 trim();
+
+    friend class Buffer;
+    friend class ThreadBlockCache;
+private:
+    static void release(u8* data, u64 size);
+
+    static u8* allocateSlab(u64 size, bool hugePages);
+    static void freeSlab(u8* slab, u64 size);
+};
+
+} // namespace simpleHTTP
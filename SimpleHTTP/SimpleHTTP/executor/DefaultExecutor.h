@@ -3,23 +3,150 @@
 
 #include <optional>
 #include <vector>
+#include <deque>
 #include <functional>
+#include <type_traits>
 #include <thread>
 #include <mutex>
+#include <shared_mutex>
+#include <atomic>
 #include <stop_token>
 #include <condition_variable>
 
 namespace simpleHTTP {
 
+/// @brief Settings of a queue of requests waiting for a compute thread.
+struct ExecutorLaneSettings
+{
+    /// @brief Lanes with a higher priority are served first by the shared compute threads.
+    u32 priority = 0;
+    /// @brief Number of compute threads that only serve this lane.
+    u32 reservedThreads = 0;
+    /// @brief Maximum number of queued requests. Any further request is rejected with Service Unavailable.
+    /// @note 0 means no limit.
+    u32 maxQueuedRequests = 0;
+};
+
+struct DefaultExecutorSettings
+{
+    /// @brief Number of threads that parse requests and write responses.
+    u32 ioThreads = 4;
+    /// @brief Number of threads that run the handlers, including the ones reserved by the lanes.
+    /// @note When 0, the handlers run directly on the I/O threads.
+    u32 computeThreads = 0;
+    /// @brief Lanes selected by the request classifier. When empty, a single default lane is used.
+    /// @note Lanes have effect only when computeThreads is greater than 0.
+    std::vector<ExecutorLaneSettings> lanes;
+};
+
+/// @brief Base class of the state that handlers keep for each executor thread.
+/// Each thread that runs handlers owns exactly one context, so it can be used without synchronization.
+class WorkerContext
+{
+public:
+    virtual inline ~WorkerContext() {}
+};
+
+class DefaultExecutor;
+
+/// @brief Owns a connection together with its pending request and response.
+/// It allows an asynchronous handler to produce the response later, from any thread.
+class RequestCompletion : public std::enable_shared_from_this<RequestCompletion>
+{
+public:
+    RequestCompletion(const RequestCompletion&) = delete;
+
+    const HttpRequest& getRequest() const;
+    HttpResponse& getResponse();
+
+    /// @brief Sends the response and releases the connection.
+    /// @note Only the first call has effect. It can be called from any thread, even after the executor
+    /// is destroyed, the response then being written by the calling thread.
+    /// @param success If false, an Internal Server Error is sent instead, unless the response was already sent.
+    void complete(bool success = true);
+
+    bool isCompleted() const;
+
+    RequestCompletion& operator=(const RequestCompletion&) = delete;
+
+    /// @brief Completes the request with a failure if it was never completed.
+    ~RequestCompletion();
+
+    friend class DefaultExecutor;
+private:
+    HttpServerConnection m_Connection;
+    HttpRequest m_Request;
+    HttpResponse m_Response;
+    std::atomic<bool> m_Completed = false;
+
+    // Shared by an executor with its completions, and cleared when it is destroyed.
+    struct ExecutorLink
+    {
+        std::shared_mutex mutex;
+        DefaultExecutor* executor = nullptr;
+    };
+
+    Ref<ExecutorLink> m_ExecutorLink;
+
+    RequestCompletion(HttpServerConnection&& connection);
+
+    bool markCompleted(bool success);
+    void finish();
+};
+
 class DefaultExecutor
 {
 public:
     DefaultExecutor();
+    explicit DefaultExecutor(DefaultExecutorSettings settings);
 
     // TODO: This should be passed to the run function
+    /// @brief Sets the handler of the requests.
+    /// @note The handler can optionally take the WorkerContext of the calling thread as third parameter.
     template<typename Func>
     void setProcessRequest(Func&& func) {
-        m_ProcessRequest = func;
+        if constexpr (std::is_invocable_r_v<bool, Func&, const HttpRequest&, HttpResponse&, WorkerContext&>) {
+            m_ProcessRequest = std::forward<Func>(func);
+        }
+        else {
+            m_ProcessRequest = [func = std::forward<Func>(func)](const HttpRequest& request, HttpResponse& response, WorkerContext&) mutable {
+                return func(request, response);
+            };
+        }
+    }
+
+    /// @brief Sets a handler that receives the request completion and returns immediately.
+    /// The handler must eventually call RequestCompletion::complete, possibly from another thread.
+    /// @note When set, it takes precedence over the synchronous handler.
+    /// The handler can optionally take the WorkerContext of the calling thread as second parameter,
+    /// which must not be used once the handler has returned.
+    template<typename Func>
+    void setAsyncProcessRequest(Func&& func) {
+        if constexpr (std::is_invocable_v<Func&, Ref<RequestCompletion>, WorkerContext&>) {
+            m_AsyncProcessRequest = std::forward<Func>(func);
+        }
+        else {
+            m_AsyncProcessRequest = [func = std::forward<Func>(func)](Ref<RequestCompletion> completion, WorkerContext&) mutable {
+                func(std::move(completion));
+            };
+        }
+    }
+
+    /// @brief Sets the function that creates the WorkerContext of each thread running handlers.
+    /// It must return a std::unique_ptr to a class derived from WorkerContext.
+    /// The contexts are made by run on its calling thread before any worker starts, so an exception
+    /// thrown by the factory is propagated by run.
+    /// @note This function has effect only when called before run.
+    template<typename Func>
+    void setWorkerContextFactory(Func&& func) {
+        m_CreateWorkerContext = std::forward<Func>(func);
+    }
+
+    /// @brief Sets a function that returns the lane index of a request.
+    /// @note An index outside the configured lanes selects lane 0.
+    template<typename Func>
+    void setRequestClassifier(Func&& func) {
+        m_ClassifyRequest = func;
     }
 
     /// @brief 
@@ -27,30 +154,80 @@ public:
     /// @param server 
     void run(HttpServer& server);
 
+    /// @brief Stops accepting connections and releases the threads.
+    /// Responses already produced are still written, and requests still waiting for a compute thread
+    /// are answered with Service Unavailable.
     void stop();
 
     ~DefaultExecutor();
+
+    friend class RequestCompletion;
 private:
+    const DefaultExecutorSettings m_Settings;
     std::stop_source m_StopSource;
+    const Ref<RequestCompletion::ExecutorLink> m_CompletionLink;
 
     std::mutex m_StateMutex;
     bool m_Started = false;
-    u32 m_MinThread = 4;
     u32 m_MaxThread = 0;
     std::vector<std::jthread> m_Threads;
+    std::vector<std::jthread> m_ComputeThreads;
 
+    // Shared by the I/O threads: new connections and responses ready to be written.
     std::optional<HttpServerConnection> m_StagedConnection;
+    std::deque<Ref<RequestCompletion>> m_PendingWrites;
     std::mutex m_StagedConnectionMutex;
     std::condition_variable m_StagedConnectionCV;
 
-    std::function<bool(const HttpRequest&, HttpResponse&)> m_ProcessRequest;
+    struct Lane
+    {
+        ExecutorLaneSettings settings;
+        std::deque<Ref<RequestCompletion>> pendingRequests;
+        // Waited on by the threads reserved to this lane.
+        std::condition_variable reservedCV;
+    };
+
+    static constexpr u32 SHARED_LANE = ~0u;
+
+    // Shared by the compute threads: the lanes and the order in which shared threads serve them.
+    std::vector<Lane> m_Lanes;
+    std::vector<u32> m_LaneOrder;
+    std::mutex m_PendingRequestsMutex;
+    std::condition_variable m_PendingRequestsCV;
+
+    std::function<bool(const HttpRequest&, HttpResponse&, WorkerContext&)> m_ProcessRequest;
+    std::function<void(Ref<RequestCompletion>, WorkerContext&)> m_AsyncProcessRequest;
+    std::function<u32(const HttpRequest&)> m_ClassifyRequest;
+    std::function<URef<WorkerContext>()> m_CreateWorkerContext;
 
     void setup();
 
-    void processConnectionsImpl();
+    void processConnectionsImpl(WorkerContext* context);
     static void processConnections(std::stop_token threadStopToken,
         std::stop_token executorStopToken,
-        DefaultExecutor* executor);
+        DefaultExecutor* executor,
+        URef<WorkerContext> context);
+
+    void processRequestsImpl(u32 lane, WorkerContext& context);
+    static void processRequests(std::stop_token threadStopToken,
+        std::stop_token executorStopToken,
+        DefaultExecutor* executor,
+        u32 lane,
+        URef<WorkerContext> context);
+
+    void enqueue(Ref<RequestCompletion> completion);
+    bool hasPendingRequests(u32 lane) const;
+
+    URef<WorkerContext> makeWorkerContext();
+    void dispatch(Ref<RequestCompletion> completion, WorkerContext& context);
+    /// @brief Queues the response for an I/O thread to write it.
+    /// @return false if the executor is stopped, the caller must then write it.
+    bool scheduleWrite(Ref<RequestCompletion> completion);
+
+    /// @brief Writes the responses still queued, once the executor is stopped.
+    void finishPendingWrites();
+    /// @brief Answers the requests still waiting for a compute thread with Service Unavailable, once the executor is stopped.
+    void rejectPendingRequests();
 };
 
 }
@@ -0,0 +1,141 @@
+#pragma once
+#include <SimpleHTTP/http.h>
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+#include <type_traits>
+#include <thread>
+#include <mutex>
+#include <stop_token>
+#include <iostream>
+
+namespace simpleHTTP {
+
+template<typename Handler>
+concept StaticRequestHandler = std::is_invocable_r_v<bool, Handler&, const HttpRequest&, HttpResponse&>;
+
+struct StaticExecutorSettings
+{
+    /// @brief Number of threads that accept connections and run the handler, including the one calling run.
+    u32 threads = 4;
+};
+
+/// @brief Executor whose handler type is known at compile time, so that the call to the handler can be inlined.
+/// Each thread accepts its own connections and runs the handler directly, without any queue or type erasure.
+/// @note It has none of the lanes, compute threads or asynchronous completion of the DefaultExecutor.
+/// @note Only the handler is specialized: the connections still reach their socket through ClientSocketImpl,
+/// so every send and receive remains a virtual call.
+template<StaticRequestHandler Handler>
+class StaticExecutor
+{
+public:
+    explicit StaticExecutor(Handler handler, StaticExecutorSettings settings = {})
+        : m_Settings(settings), m_Handler(std::move(handler)) {}
+
+    StaticExecutor(const StaticExecutor&) = delete;
+
+    /// @brief Serves the connections of the server until the executor or the server is stopped.
+    /// @note This function has effect only when called the first time.
+    void run(HttpServer& server) {
+        {
+            std::scoped_lock lk(m_StateMutex);
+
+            if (m_Started) {
+                return;
+            }
+
+            m_Started = true;
+
+            const u32 threads = std::max(m_Settings.threads, 1u);
+            m_Threads.reserve(threads - 1);
+            for (u32 i = 1; i < threads; ++i) {
+                m_Threads.emplace_back([this, &server](std::stop_token st) {
+                    processConnections(st, server);
+                });
+            }
+        }
+
+        processConnections(m_StopSource.get_token(), server);
+
+        stop();
+    }
+
+    /// @note Threads blocked waiting for a connection return only once the server is stopped too.
+    void stop() {
+        m_StopSource.request_stop();
+    }
+
+    StaticExecutor& operator=(const StaticExecutor&) = delete;
+
+    ~StaticExecutor() {
+        stop();
+
+        // The threads use the handler, so they must be joined before it is destroyed.
+        m_Threads.clear();
+    }
+private:
+    const StaticExecutorSettings m_Settings;
+    Handler m_Handler;
+    std::stop_source m_StopSource;
+
+    std::mutex m_StateMutex;
+    bool m_Started = false;
+    std::vector<std::jthread> m_Threads;
+
+    void processConnections(std::stop_token threadStopToken, HttpServer& server) {
+        while (!(threadStopToken.stop_requested() || m_StopSource.stop_requested())) {
+            std::optional<HttpServerConnection> connection = std::nullopt;
+
+            try {
+                connection = server.accept();
+            } catch (const std::exception&) {
+                break;
+            }
+
+            processConnection(*connection);
+        }
+    }
+
+    void processConnection(HttpServerConnection& connection) {
+        try {
+            // The connection already closed itself if the request could not be received.
+            HttpRequest request = connection.getNextRequest();
+            HttpResponse response = connection.makeResponse();
+            response.setVersion(request.getVersion());
+
+            bool success = false;
+            if (request.isExpired()) {
+                // The response could not be delivered in time, the handler is not worth running.
+                response.setStatusCode(StatusCode::SERVICE_UNAVAILABLE);
+                success = true;
+            }
+            else {
+                try {
+                    success = m_Handler(request, response);
+                } catch (...) {}
+            }
+
+            if (!success && !response.wasSent()) {
+                // Failure
+                response.setStatusCode(StatusCode::INTERNAL_SERVER_ERROR);
+                response.clearHeaderFields();
+                response.generateDefaultReasonPhrase();
+            }
+
+            if (!response.wasSent()) {
+                response.send();
+            }
+        } catch (const std::exception& ex) {
+            // TODO: Proper Logging
+            std::cout << ex.what() << std::endl;
+        } catch (...) {
+            // TODO: Proper Logging
+            std::cout << "Unrecognized Exception" << std::endl;
+        }
+
+        connection.close();
+    }
+};
+
+} // namespace simpleHTTP
@@ -1,36 +1,160 @@
 #pragma once
 #include <SimpleHTTP/http.h>
 #include <SimpleHTTP/handler/Resource.h>
-
-#include <map>
+#include <SimpleHTTP/handler/Middleware.h>
+#include <SimpleHTTP/handler/Router.h>
+
+#include <array>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <optional>
+#include <condition_variable>
 
 namespace simpleHTTP {
 
+/// @brief Caching allowed for the responses, sent as Cache-Control and, optionally, Expires.
+/// Error responses (4xx and 5xx) are always sent with "no-cache" instead.
+/// @note The default policy has every response revalidated ("no-cache").
+struct CachePolicy
+{
+    /// @brief Time for which a response is fresh in any cache. Negative means that it must be revalidated.
+    std::chrono::seconds maxAge{ -1 };
+    /// @brief Time for which a response is fresh in shared caches such as CDNs, overriding maxAge there.
+    /// @note Negative means none.
+    std::chrono::seconds sharedMaxAge{ -1 };
+    /// @brief The response never changes while fresh, as for assets whose name holds a fingerprint of their content.
+    bool immutable = false;
+    /// @brief Only the cache of the client may store the response.
+    bool isPrivate = false;
+    /// @brief No cache may store the response, the other fields being ignored.
+    bool noStore = false;
+    /// @brief Also send an Expires field matching maxAge, for HTTP/1.0 caches.
+    bool expires = false;
+};
+
+struct RouteSettings
+{
+    /// @brief Index of the executor lane that the requests of the route are queued on.
+    u32 lane = 0;
+    /// @brief Largest Content-Length accepted by the route, checked by validateRequest.
+    /// @note 0 means the limit of the server.
+    u64 maxContentLength = 0;
+    /// @brief Called by validateRequest with the header fields of the requests of the route, before their content.
+    /// It can reject a request by throwing an HttpException, for instance with Unauthorized, so that a client
+    /// expecting 100 Continue does not send the content.
+    std::function<void(const HttpRequest&)> requestValidator;
+
+    /// @brief Maximum number of requests of the route processed at once. Any further request waits in
+    /// the queue of the route, or is rejected with Service Unavailable when the queue is full.
+    /// @note 0 means no limit.
+    u32 maxConcurrentRequests = 0;
+    /// @brief Maximum number of requests waiting for the route. 0 means that excess requests are rejected at once.
+    u32 maxQueuedRequests = 0;
+    /// @brief Maximum time a request waits in the queue, which is also bounded by the request deadline.
+    /// A waiting request holds its thread, so the default is short enough for a saturated route to shed
+    /// its load rather than take every thread.
+    /// @note 0 means that only the request deadline applies, without one a request may then wait indefinitely.
+    std::chrono::milliseconds queueTimeout{ 1000 };
+
+    /// @brief Cache policy of the responses of the route, preferred to the ones of the extensions.
+    std::optional<CachePolicy> cachePolicy;
+};
+
+/// @brief Bounds the number of requests processed at once by a route, so that it cannot occupy every thread.
+/// @note A slot is held until the body of the response is sent, and a queued request waits on its thread.
+class Bulkhead
+{
+public:
+    Bulkhead(u32 maxConcurrentRequests, u32 maxQueuedRequests);
+    Bulkhead(const Bulkhead&) = delete;
+
+    /// @brief Takes a slot, waiting until the deadline if the queue has room.
+    /// @return false if the request must be rejected.
+    bool enter(std::chrono::steady_clock::time_point deadline);
+    void leave();
+
+    Bulkhead& operator=(const Bulkhead&) = delete;
+private:
+    const u32 m_MaxConcurrentRequests;
+    const u32 m_MaxQueuedRequests;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_CV;
+    u32 m_ActiveRequests = 0;
+    u32 m_QueuedRequests = 0;
+};
+
 class RequestProcessor
 {
 public:
     using ProcessFunction = std::function<std::unique_ptr<Resource>(const HttpRequest&)>;
     using InitializerList = std::initializer_list<std::pair<HttpMethod, ProcessFunction>>;
 
-    RequestProcessor(InitializerList processors);
+    RequestProcessor(InitializerList processors, RouteSettings settings = {});
+    /// @note The copy has its own bulkhead.
+    RequestProcessor(const RequestProcessor& other);
 
     std::string getMethodsList() const;
 
+    /// @brief Returns the constant header fields of the responses of the route, serialized once.
+    const std::string& getHeaderBlock() const;
+
+    const RouteSettings& getSettings() const;
+
+    /// @brief Takes a slot of the bulkhead of the route, if it has a concurrency limit.
+    /// @return false if the request must be rejected.
+    bool enter(const HttpRequest& request) const;
+    void leave() const;
+
     std::unique_ptr<Resource> operator()(const HttpRequest& request) const;
 private:
-    std::unordered_map<HttpMethod, ProcessFunction> m_ProcessFunctions;
+    std::array<ProcessFunction, HTTP_METHOD_COUNT> m_ProcessFunctions;
+    std::string m_HeaderBlock;
+    RouteSettings m_Settings;
+    URef<Bulkhead> m_Bulkhead;
 };
 
 class DefaultRequestHandlerSettings
 {
 public:
     HttpVersion httpVersion = HttpVersion::V1_0;
+    /// @brief Cache policy of the responses whose route and extension have none.
+    CachePolicy cachePolicy;
 
-    void registerRequestProcessor(std::string_view uri, RequestProcessor::InitializerList processors);
+    /// @param uri Path of the route, such as "/users/{id}/posts/*". The captured parameters are given by
+    /// HttpRequest::getPathParameters, see Router for the matching rules.
+    void registerRequestProcessor(std::string_view uri, RequestProcessor::InitializerList processors,
+        RouteSettings routeSettings = {});
+
+    /// @brief Registers a route served only to the requests for a host, such as "example.com",
+    /// or "*.example.com" for any of its subdomains.
+    /// @note A request for a host with routes of its own is matched only against them, the exact host being
+    /// preferred to the longest wildcard. Requests for other hosts use the routes registered without a host.
+    void registerRequestProcessor(std::string_view host, std::string_view uri,
+        RequestProcessor::InitializerList processors, RouteSettings routeSettings = {});
+
+    /// @brief Sets the cache policy of the responses to the requests whose path ends with the extension,
+    /// such as "js" or ".js", compared regardless of case.
+    void setExtensionCachePolicy(std::string_view extension, CachePolicy policy);
+
+    /// @brief Adds a middleware run before the routing, after the ones already added.
+    void addMiddleware(MiddlewarePipeline::Middleware middleware);
 
     friend class DefaultRequestHandler;
 private:
-    std::map<URI, RequestProcessor> m_RequestProcessors;
+    struct Route
+    {
+        std::string host;
+        std::string uri;
+        RequestProcessor processor;
+    };
+
+    std::vector<Route> m_RequestProcessors;
+    std::vector<std::pair<std::string, CachePolicy>> m_ExtensionCachePolicies;
+    MiddlewarePipeline m_Middlewares;
 };
 
 class DefaultRequestHandler
@@ -41,15 +165,63 @@ public:
 
     bool processRequest(const HttpRequest& request, HttpResponse& response) const;
 
+    /// @brief Returns the executor lane of the route matching the request, or 0 if none matches.
+    u32 classifyRequest(const HttpRequest& request) const;
+
+    /// @brief Applies the limits of the route matching the request, before its content is received.
+    /// It is meant to be used as HttpServerSettings::requestValidator.
+    /// @throw HttpException if the request exceeds the limits.
+    void validateRequest(const HttpRequest& request) const;
+
     DefaultRequestHandler& operator=(const DefaultRequestHandler&) = delete;
 
     ~DefaultRequestHandler();
 private:
     const HttpVersion m_HttpVersion;
 
-    const std::function<bool(const HttpRequest&)> m_RequestFilter;
-    const std::map<URI, RequestProcessor> m_RequestProcessors;
-
+    struct StringHash
+    {
+        using is_transparent = void;
+
+        inline std::size_t operator()(std::string_view string) const {
+            return std::hash<std::string_view>{}(string);
+        }
+    };
+
+    using HostRouters = std::unordered_map<std::string, Router, StringHash, std::equal_to<>>;
+
+    // Cache headers serialized once, only Expires depending on the time of the response.
+    struct CacheHeaders
+    {
+        std::string headerBlock;
+        bool expires = false;
+        std::chrono::seconds maxAge{ 0 };
+    };
+
+    const MiddlewarePipeline m_Middlewares;
+    std::vector<RequestProcessor> m_RequestProcessors;
+    Router m_Router;
+    // Keyed on the normalized host, and on the domain following "*." for the wildcards.
+    HostRouters m_HostRouters;
+    HostRouters m_WildcardHostRouters;
+
+    CacheHeaders m_CacheHeaders;
+    // Indexed as the request processors.
+    std::vector<std::optional<CacheHeaders>> m_RouteCacheHeaders;
+    std::unordered_map<std::string, CacheHeaders, StringHash, std::equal_to<>> m_ExtensionCacheHeaders;
+
+    bool dispatchRequest(const HttpRequest& request, HttpResponse& response) const;
+
+    void addCacheHeaders(const HttpRequest& request, HttpResponse& response, StatusCodeType statusCode,
+        u32 route) const;
+
+    const Router& selectRouter(std::string_view host) const;
+
+    /// @brief Returns the index of the route matching the request in the request processors, or Router::NO_MATCH.
+    u32 findRoute(const HttpRequest& request, PathParameters* parameters = nullptr) const;
+    /// @brief Same as findRoute, but the route and its path parameters are stored in the request on the first call,
+    /// so that validateRequest, classifyRequest and dispatchRequest match the request only once.
+    u32 matchRoute(const HttpRequest& request) const;
 };
 
 } // namespace simpleHTTP
@@ -0,0 +1,112 @@
+#pragma once
+#include <SimpleHTTP/http.h>
+
+#include <tuple>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <type_traits>
+
+namespace simpleHTTP {
+
+/*
+ * A middleware is invoked as middleware(request, response, next) and returns whether the request succeeded.
+ * Calling next() runs the rest of the chain and returns its result; a middleware that does not call it
+ * stops the request there. Changes to the response must be made before calling next, since the handler
+ * may send it.
+ *
+ * A middleware taking next as `auto&` can be used both in a MiddlewareChain and in a MiddlewarePipeline.
+ */
+
+/// @brief Middlewares composed in front of a handler at compile time.
+/// Every call is direct, so the whole chain can be inlined, and nothing is allocated per request.
+template<typename Handler, typename... Middlewares>
+class MiddlewareChain
+{
+public:
+    explicit MiddlewareChain(Handler handler, Middlewares... middlewares)
+        : m_Handler(std::move(handler)), m_Middlewares(std::move(middlewares)...) {}
+
+    bool operator()(const HttpRequest& request, HttpResponse& response) {
+        return invoke<0>(request, response);
+    }
+private:
+    Handler m_Handler;
+    std::tuple<Middlewares...> m_Middlewares;
+
+    template<std::size_t I>
+    bool invoke(const HttpRequest& request, HttpResponse& response) {
+        if constexpr (I == sizeof...(Middlewares)) {
+            return m_Handler(request, response);
+        }
+        else {
+            auto next = [this, &request, &response] {
+                return invoke<I + 1>(request, response);
+            };
+
+            return std::get<I>(m_Middlewares)(request, response, next);
+        }
+    }
+};
+
+class MiddlewarePipeline;
+
+/// @brief Runs the rest of a MiddlewarePipeline.
+class MiddlewareNext
+{
+public:
+    bool operator()() const;
+
+    friend class MiddlewarePipeline;
+private:
+    struct Invocation;
+
+    const Invocation& m_Invocation;
+    std::size_t m_Index;
+
+    MiddlewareNext(const Invocation& invocation, std::size_t index);
+};
+
+struct MiddlewareNext::Invocation
+{
+    const MiddlewarePipeline& pipeline;
+    const HttpRequest& request;
+    HttpResponse& response;
+    void* handler;
+    bool (*invokeHandler)(void*, const HttpRequest&, HttpResponse&);
+};
+
+/// @brief Middlewares registered at runtime, run in order of registration in front of a handler.
+class MiddlewarePipeline
+{
+public:
+    using Middleware = std::function<bool(const HttpRequest&, HttpResponse&, const MiddlewareNext&)>;
+
+    void add(Middleware middleware);
+
+    bool empty() const;
+
+    template<typename Handler>
+    bool run(const HttpRequest& request, HttpResponse& response, Handler&& handler) const {
+        if (m_Middlewares.empty()) {
+            return handler(request, response);
+        }
+
+        void* handlerAddress = const_cast<void*>(static_cast<const void*>(std::addressof(handler)));
+
+        const MiddlewareNext::Invocation invocation{ *this, request, response, handlerAddress,
+            [](void* h, const HttpRequest& rq, HttpResponse& rs) -> bool {
+                return (*static_cast<std::remove_reference_t<Handler>*>(h))(rq, rs);
+            } };
+
+        return run(invocation, 0);
+    }
+
+    friend class MiddlewareNext;
+private:
+    std::vector<Middleware> m_Middlewares;
+
+    bool run(const MiddlewareNext::Invocation& invocation, std::size_t index) const;
+};
+
+} // namespace simpleHTTP
@@ -0,0 +1,74 @@
+#pragma once
+#include <SimpleHTTP/types.h>
+#include <SimpleHTTP/URI.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+
+namespace simpleHTTP {
+
+/// @brief Compressed radix trie keyed on path segments, matching the longest registered prefix of a path.
+/// Chains of nodes with a single child are merged, and a match looks up each segment of the path at most once
+/// unless parameters make several routes possible.
+///
+/// A segment "{name}" matches any single segment, captured as the parameter name, and a last segment "*"
+/// matches the rest of the path, captured as the parameter "*". When several routes match as much of the path,
+/// literal segments are preferred to parameters, and parameters to wildcards.
+/// @note Empty segments are ignored, so "/a//b/" is the same path as "/a/b".
+class Router
+{
+public:
+    static constexpr u32 NO_MATCH = ~0u;
+
+    Router();
+
+    /// @brief Associates a value to a path, replacing the value of a path registered before.
+    /// @throw std::runtime_error if the path is not a valid pattern, or conflicts with the name of a parameter
+    /// registered before at the same position.
+    void insert(std::string_view path, u32 value);
+
+    /// @brief Returns the value of the longest registered prefix of the path, or NO_MATCH.
+    /// @param parameters Receives the parameters captured by the match, if any. Their names are views into the router.
+    u32 match(std::string_view path, PathParameters* parameters = nullptr) const;
+private:
+    static constexpr u32 NO_NODE = ~0u;
+
+    struct SegmentHash
+    {
+        using is_transparent = void;
+
+        inline std::size_t operator()(std::string_view segment) const {
+            return std::hash<std::string_view>{}(segment);
+        }
+    };
+
+    struct Node
+    {
+        // Literal segments of the edge from the parent, the first one being the key in the parent.
+        // A parameter node has none, it matches a single segment of any value.
+        std::vector<std::string> label;
+        std::string parameterName;
+        std::unordered_map<std::string, u32, SegmentHash, std::equal_to<>> children;
+        u32 parameter = NO_NODE;
+        u32 value = NO_MATCH;
+        u32 wildcardValue = NO_MATCH;
+    };
+
+    struct Match
+    {
+        u32 value = NO_MATCH;
+        // Length of the path left unmatched, the best match being the shortest.
+        u64 remaining = 0;
+        PathParameters parameters;
+    };
+
+    std::vector<Node> m_Nodes;
+
+    /// @return true once the whole path is matched, in which case no other branch can be preferred.
+    bool match(u32 index, std::string_view path, const PathParameters& captures, Match& best) const;
+};
+
+} // namespace simpleHTTP
@@ -0,0 +1,272 @@
+#pragma once
+#include <SimpleHTTP/http.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+namespace simpleHTTP {
+
+/// @brief Path of a route given as a template argument, normalized without leading, trailing or repeated slashes.
+template<std::size_t N>
+struct RoutePath
+{
+    char data[N]{};
+    u64 size = 0;
+
+    constexpr RoutePath(const char (&path)[N]) {
+        for (std::size_t i = 0; i + 1 < N; ++i) {
+            if (path[i] != '/') {
+                data[size++] = path[i];
+            }
+            else if (size > 0 && data[size - 1] != '/') {
+                data[size++] = '/';
+            }
+        }
+
+        if (size > 0 && data[size - 1] == '/') {
+            --size;
+        }
+    }
+
+    constexpr std::string_view view() const {
+        return std::string_view(data, size);
+    }
+};
+
+/// @brief Table of routes fixed at compile time, matching the longest route that is a prefix of a path.
+/// The routes are placed in a perfect hash table built by the compiler, at most half full, so a match hashes
+/// the path once and looks up at most one slot per segment, with nothing built at startup.
+/// @note Unlike the Router, routes are literal: they have no parameters or wildcards.
+template<RoutePath... Paths>
+class StaticRouteTable
+{
+public:
+    static constexpr u32 NO_MATCH = ~0u;
+    static constexpr u64 COUNT = sizeof...(Paths);
+
+    static_assert(COUNT > 0, "A route table needs at least one route.");
+
+    /// @brief Returns the index of the longest route that is a prefix of the path, or NO_MATCH.
+    /// @note Empty segments are ignored, as in the Router.
+    static constexpr u32 match(std::string_view path) {
+        std::array<u64, MAX_DEPTH + 1> prefixHashes{};
+
+        u64 hash = HASH_OFFSET;
+        u64 depth = 0;
+        prefixHashes[0] = hash;
+
+        std::string_view rest = path;
+        std::string_view segment;
+        while (depth < MAX_DEPTH && nextSegment(rest, segment)) {
+            if (depth > 0) {
+                hash = appendHash(hash, "/");
+            }
+            hash = appendHash(hash, segment);
+            prefixHashes[++depth] = hash;
+        }
+
+        for (u64 d = depth + 1; d-- > 0;) {
+            const u32 index = LAYOUT.slots[getSlot(prefixHashes[d])];
+
+            if (index != NO_MATCH && isPrefix(PATHS[index], path, d)) {
+                return index;
+            }
+        }
+
+        return NO_MATCH;
+    }
+private:
+    static constexpr u64 HASH_OFFSET = 0xcbf29ce484222325;
+    static constexpr u64 HASH_PRIME = 0x100000001b3;
+    static constexpr u64 MAX_SEED = 0x100000;
+
+    static constexpr u64 BUCKET_COUNT = COUNT;
+    static constexpr u64 SLOT_COUNT = std::bit_ceil(2 * COUNT);
+
+    static constexpr std::array<std::string_view, COUNT> PATHS{ Paths.view()... };
+
+    struct Layout
+    {
+        std::array<u64, BUCKET_COUNT> seeds{};
+        std::array<u32, SLOT_COUNT> slots{};
+    };
+
+    static constexpr bool nextSegment(std::string_view& path, std::string_view& segment) {
+        const auto begin = path.find_first_not_of('/');
+        if (begin == std::string_view::npos) {
+            path = std::string_view();
+            return false;
+        }
+
+        const auto end = path.find('/', begin);
+        segment = path.substr(begin, end - begin);
+        path = end == std::string_view::npos ? std::string_view() : path.substr(end);
+        return true;
+    }
+
+    static constexpr u64 countSegments(std::string_view path) {
+        u64 count = 0;
+        for (std::string_view segment; nextSegment(path, segment);) {
+            ++count;
+        }
+        return count;
+    }
+
+    static constexpr u64 MAX_DEPTH = std::max({ countSegments(Paths.view())... });
+
+    static constexpr u64 appendHash(u64 hash, std::string_view text) {
+        for (char c : text) {
+            hash ^= static_cast<u8>(c);
+            hash *= HASH_PRIME;
+        }
+        return hash;
+    }
+
+    // The slot of a path is derived from its hash and the seed of its bucket, so the path is hashed only once.
+    static constexpr u64 mix(u64 value) {
+        value ^= value >> 30;
+        value *= 0xbf58476d1ce4e5b9;
+        value ^= value >> 27;
+        value *= 0x94d049bb133111eb;
+        value ^= value >> 31;
+        return value;
+    }
+
+    static constexpr u64 getBucket(u64 hash) {
+        return hash % BUCKET_COUNT;
+    }
+
+    static constexpr u64 getSlot(u64 hash, u64 seed) {
+        return mix(hash ^ seed) & (SLOT_COUNT - 1);
+    }
+
+    static constexpr u64 getSlot(u64 hash) {
+        return getSlot(hash, LAYOUT.seeds[getBucket(hash)]);
+    }
+
+    /// @brief Whether the first segments of the path are the ones of the route.
+    static constexpr bool isPrefix(std::string_view route, std::string_view path, u64 depth) {
+        std::string_view routeSegment;
+        std::string_view pathSegment;
+
+        for (u64 i = 0; i < depth; ++i) {
+            if (!nextSegment(route, routeSegment) || !nextSegment(path, pathSegment) || routeSegment != pathSegment) {
+                return false;
+            }
+        }
+
+        return !nextSegment(route, routeSegment);
+    }
+
+    static constexpr Layout buildLayout() {
+        Layout layout;
+        layout.slots.fill(NO_MATCH);
+
+        std::array<u64, COUNT> hashes{};
+        std::array<u64, BUCKET_COUNT> bucketSizes{};
+        for (u64 i = 0; i < COUNT; ++i) {
+            hashes[i] = appendHash(HASH_OFFSET, PATHS[i]);
+            ++bucketSizes[getBucket(hashes[i])];
+
+            for (u64 j = 0; j < i; ++j) {
+                if (hashes[j] == hashes[i]) {
+                    throw std::logic_error("Duplicate routes in the table.");
+                }
+            }
+        }
+
+        // The largest buckets are placed first, while most slots are free.
+        for (u64 size = COUNT; size > 0; --size) {
+            for (u64 bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+                if (bucketSizes[bucket] != size) {
+                    continue;
+                }
+
+                u64 seed = 0;
+                while (!tryPlaceBucket(layout, hashes, bucket, seed)) {
+                    if (++seed == MAX_SEED) {
+                        throw std::logic_error("Unable to build the route table.");
+                    }
+                }
+            }
+        }
+
+        return layout;
+    }
+
+    static constexpr bool tryPlaceBucket(Layout& layout, const std::array<u64, COUNT>& hashes, u64 bucket, u64 seed) {
+        std::array<u64, COUNT> placed{};
+        u64 placedCount = 0;
+
+        for (u64 i = 0; i < COUNT; ++i) {
+            if (getBucket(hashes[i]) != bucket) {
+                continue;
+            }
+
+            const u64 slot = getSlot(hashes[i], seed);
+            if (layout.slots[slot] != NO_MATCH) {
+                for (u64 j = 0; j < placedCount; ++j) {
+                    layout.slots[placed[j]] = NO_MATCH;
+                }
+                return false;
+            }
+
+            layout.slots[slot] = static_cast<u32>(i);
+            placed[placedCount++] = slot;
+        }
+
+        layout.seeds[bucket] = seed;
+        return true;
+    }
+
+    static constexpr Layout LAYOUT = buildLayout();
+};
+
+/// @brief Request handler dispatching to handlers whose routes and types are known at compile time.
+/// The matched handler is called directly, so it can be inlined, for instance in a StaticExecutor.
+/// Requests matching no route are given to the fallback, which may be a DefaultRequestHandler whose
+/// routes are registered at runtime.
+template<typename Table, typename Fallback, typename... Handlers>
+class StaticRouter
+{
+public:
+    static_assert(Table::COUNT == sizeof...(Handlers), "Every route needs a handler.");
+
+    explicit StaticRouter(Fallback fallback, Handlers... handlers)
+        : m_Fallback(std::move(fallback)), m_Handlers(std::move(handlers)...) {}
+
+    bool operator()(const HttpRequest& request, HttpResponse& response) {
+        const u32 index = Table::match(request.getURI().getSegmentsSection());
+
+        if (index == Table::NO_MATCH) {
+            return m_Fallback(request, response);
+        }
+
+        return dispatch(index, request, response, std::index_sequence_for<Handlers...>{});
+    }
+private:
+    Fallback m_Fallback;
+    std::tuple<Handlers...> m_Handlers;
+
+    template<std::size_t... I>
+    bool dispatch(u32 index, const HttpRequest& request, HttpResponse& response, std::index_sequence<I...>) {
+        bool result = false;
+        ((index == I && (result = std::get<I>(m_Handlers)(request, response), true)) || ...);
+        return result;
+    }
+};
+
+/// @brief Makes a StaticRouter from the paths of its routes, such as makeStaticRouter<"/", "/api/users">(fallback, index, users).
+/// The handlers are given in the order of the paths.
+template<RoutePath... Paths, typename Fallback, typename... Handlers>
+auto makeStaticRouter(Fallback fallback, Handlers... handlers) {
+    return StaticRouter<StaticRouteTable<Paths...>, Fallback, Handlers...>(std::move(fallback), std::move(handlers)...);
+}
+
+} // namespace simpleHTTP
@@ -1,10 +1,16 @@
 #pragma once
 #include <SimpleHTTP/socket.h>
 #include <SimpleHTTP/URI.h>
+#include <SimpleHTTP/budget.h>
+#include <SimpleHTTP/query.h>
 
 #include <format>
 #include <functional>
 #include <unordered_map>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include <type_traits>
 
 namespace simpleHTTP {
 
@@ -37,6 +43,8 @@ enum class HttpMethod
     TRACE
 };
 
+constexpr u64 HTTP_METHOD_COUNT = static_cast<u64>(HttpMethod::TRACE) + 1;
+
 const char* httpMethodToString(HttpMethod m);
 
 using StatusCodeType = u16;
@@ -82,6 +90,7 @@ enum class StatusCode : StatusCodeType
     MISDIRECTED_REQUEST = 421,
     UNPROCESSABLE_CONTENT = 422,
     UPGRADE_REQUIRED = 426,
+    REQUEST_HEADER_FIELDS_TOO_LARGE = 431,
     INTERNAL_SERVER_ERROR = 500,
     NOT_IMPLEMENTED = 501,
     BAD_GATEWAY = 502,
@@ -90,6 +99,23 @@ enum class StatusCode : StatusCodeType
     HTTP_VERSION_NOT_SUPPORTED = 505
 };
 
+/// @brief Error that aborts the reception of a request, answered with the given status code.
+class HttpException : public std::runtime_error
+{
+public:
+    HttpException(StatusCode code, const std::string& message);
+
+    StatusCode getStatusCode() const;
+private:
+    StatusCode m_StatusCode;
+};
+
+/// @brief Returns the reason phrase of a status code, or nullptr if the code is unknown.
+const char* getDefaultReasonPhrase(StatusCode code);
+
+/// @brief Formats a time as an HTTP-date, such as "Sun, 06 Nov 1994 08:49:37 GMT".
+std::string formatHttpDate(std::chrono::system_clock::time_point time);
+
 using MediaType = const char*;
 
 /*
@@ -142,23 +168,76 @@ constexpr MediaType VIDEO_MP4 = "video/mp4";
 
 };
 
+class HttpRequest;
+
 struct HttpServerSettings
 {
-    u16 unused = 0;
+    /// @brief Time budget of every request, measured from the reception of its request line.
+    /// @note 0 means no deadline.
+    std::chrono::milliseconds requestDeadline{ 0 };
+    /// @brief Header field holding a client supplied budget in milliseconds.
+    /// It can only shorten the server deadline. If empty, the field is ignored.
+    std::string requestDeadlineField = "x-request-timeout";
+
+    /// @brief Maximum time waiting for the first byte of a request.
+    std::chrono::milliseconds idleTimeout{ 0 };
+    /// @brief Maximum time to receive the request line and the header fields.
+    std::chrono::milliseconds headerTimeout{ 0 };
+    /// @brief Maximum time to receive the content of a request.
+    std::chrono::milliseconds contentTimeout{ 0 };
+    /// @brief Maximum time the client can take to accept any part of a response.
+    std::chrono::milliseconds sendTimeout{ 0 };
+    /// @brief Granularity of the timeouts above, which are disabled when 0.
+    std::chrono::milliseconds timeoutResolution{ 100 };
+
+    /// @brief Maximum bytes of header fields and content buffered at once by all the requests and responses.
+    /// Requests that would exceed it are rejected with Service Unavailable.
+    /// @note 0 means no limit.
+    u64 memoryBudget = 0;
+
+    /// @brief Longest request target accepted. Longer ones are rejected with URI Too Long.
+    u64 maxUriLength = 0x2000;
+    /// @brief Longest header field line accepted. Any longer is rejected with Request Header Fields Too Large.
+    u64 maxHeaderFieldLength = 0x2000;
+    /// @brief Maximum total bytes of the header fields of a request.
+    u64 maxHeaderFieldsSize = 0x10000;
+    /// @brief Maximum number of header fields of a request.
+    u64 maxHeaderFieldCount = 100;
+    /// @brief Largest Content-Length accepted. Larger ones are rejected with Content Too Large,
+    /// before any of the content is received.
+    /// @note 0 means no limit.
+    u64 maxContentLength = 0x1000000;
+
+    /// @brief Called once the header fields of a request are received, before its content.
+    /// It can reject the request by throwing an HttpException, for instance to apply the limits of a route.
+    /// A client expecting 100 Continue is only told to send the content once the validator accepted the request.
+    std::function<void(const HttpRequest&)> requestValidator;
 };
 
 class HttpServerConnection;
+class DefaultRequestHandler;
 
 class HttpRequest
 {
 public:
     using HeaderFieldsMap = std::unordered_multimap<std::string, std::string>;
 
+    HttpRequest(const HttpRequest&) = delete;
+    HttpRequest(HttpRequest&&) = default;
+
     HttpVersion getVersion() const;
 
     HttpMethod getMethod() const;
 
-    const URI& getURI() const;
+    /// @note The view refers to memory owned by the request.
+    const URIView& getURI() const;
+
+    /// @brief Returns the value of the Host header field, as sent by the client.
+    std::string_view getHost() const;
+
+    /// @brief Returns the parameters captured from the path by the route matching the request.
+    /// @note The values are views into the URI of the request.
+    const PathParameters& getPathParameters() const;
 
     void setHeaderField(std::string_view name, std::string_view value);
     void addHeaderField(std::string_view name, std::string_view value);
@@ -171,25 +250,124 @@ public:
 
     const std::vector<u8>& getContent() const;
 
+    /// @brief Returns the parameters of the query, indexed on first access.
+    /// @note The first access must not race with other accesses to the request.
+    const QueryParameters& getQueryParameters() const;
+    /// @brief Returns the parameters of an application/x-www-form-urlencoded content, indexed on first access.
+    /// The index is empty for any other content, and while the content is not received, as in a request
+    /// validator. It is only kept once the content is received.
+    /// @note The first access must not race with other accesses to the request.
+    const QueryParameters& getFormParameters() const;
+
+    /// @brief Returns the length of the content declared by the request.
+    /// @note It is known before the content is received.
+    u64 getContentLength() const;
+
+    /// @brief Whether the client waits for a 100 Continue before sending the content.
+    bool expectsContinue() const;
+
+    bool hasDeadline() const;
+    std::chrono::steady_clock::time_point getDeadline() const;
+
+    /// @brief Returns the time left before the deadline, or duration::max() if the request has none.
+    /// @note The budget is never negative.
+    std::chrono::steady_clock::duration getRemainingBudget() const;
+
+    bool isExpired() const;
+
+    HttpRequest& operator=(const HttpRequest&) = delete;
+    HttpRequest& operator=(HttpRequest&&) = default;
+
     ~HttpRequest();
 
     friend class HttpServerConnection;
+    friend class DefaultRequestHandler;
 private:
     ClientSocket* m_Socket;
+    std::chrono::steady_clock::time_point m_Deadline = std::chrono::steady_clock::time_point::max();
     HttpVersion m_Version = HttpVersion::UNKNOWN;
     HttpMethod m_Method = HttpMethod::UNKNOWN;
-    URI m_Uri;
+    Buffer m_Target;
+    URIView m_Uri;
+    // Only set by the DefaultRequestHandler, which matches the request to a route once, as soon as it needs it.
+    mutable const DefaultRequestHandler* m_RouteHandler = nullptr;
+    mutable u32 m_Route = 0;
+    mutable PathParameters m_PathParameters;
     HeaderFieldsMap m_HeaderFields;
     std::vector<u8> m_Content;
+    mutable std::optional<QueryParameters> m_QueryParameters;
+    mutable std::optional<QueryParameters> m_FormParameters;
+    u64 m_ContentLength = 0;
+    bool m_ExpectsContinue = false;
+    MemoryReservation m_Reservation;
+
+    HttpRequest(ClientSocket* socket, const HttpServerSettings& settings, MemoryBudget* memoryBudget);
 
-    HttpRequest(ClientSocket* socket);
+    void receiveContent();
 
     std::string getFieldNameIgnoreCase(std::string_view name) const;
 };
 
+/// @brief Move-only callable writing the body of a response once its head is sent.
+/// Unlike std::function, it accepts callables that own move-only state, such as a resource.
+class ResponseBody
+{
+public:
+    ResponseBody() = default;
+    ResponseBody(std::nullptr_t) {}
+
+    template<typename Func>
+        requires (!std::is_same_v<std::remove_cvref_t<Func>, ResponseBody>) && std::is_invocable_v<Func&, ClientSocket*>
+    ResponseBody(Func&& func)
+        : m_Callable(std::make_unique<Callable<std::remove_cvref_t<Func>>>(std::forward<Func>(func))) {}
+
+    ResponseBody(const ResponseBody&) = delete;
+    ResponseBody(ResponseBody&&) noexcept = default;
+
+    inline void operator()(ClientSocket* socket) {
+        m_Callable->call(socket);
+    }
+
+    inline explicit operator bool() const {
+        return m_Callable != nullptr;
+    }
+
+    ResponseBody& operator=(const ResponseBody&) = delete;
+    ResponseBody& operator=(ResponseBody&&) noexcept = default;
+private:
+    struct CallableBase
+    {
+        virtual void call(ClientSocket* socket) = 0;
+
+        virtual inline ~CallableBase() {}
+    };
+
+    template<typename Func>
+    struct Callable final : CallableBase
+    {
+        Func func;
+
+        template<typename F>
+        explicit Callable(F&& f)
+            : func(std::forward<F>(f)) {}
+
+        void call(ClientSocket* socket) override {
+            func(socket);
+        }
+    };
+
+    URef<CallableBase> m_Callable;
+};
+
 class HttpResponse
 {
 public:
+    HttpResponse(const HttpResponse&) = delete;
+    HttpResponse(HttpResponse&&) = default;
+
+    HttpResponse& operator=(const HttpResponse&) = delete;
+    HttpResponse& operator=(HttpResponse&&) = default;
+
     ~HttpResponse();
 
     void setVersion(HttpVersion version);
@@ -203,12 +381,22 @@ public:
     void setUseDefaultReasonPhrase(bool v);
 
     void addHeaderField(std::string_view name, std::string_view value);
+    /// @brief Appends header fields already serialized as "Name: value\r\n" lines, in a single copy.
+    /// @note The block is not validated, it is meant for constant fields prepared in advance.
+    void addHeaderBlock(std::string_view block);
     void clearHeaderFields();
 
     bool wasSent() const;
 
     void send();
-    void send(std::function<void(ClientSocket*)> body);
+    void send(ResponseBody body);
+
+    /// @brief When enabled, send only records the response, which is written by flush.
+    /// @note The body callback may then be invoked on a different thread.
+    void setDeferSend(bool v);
+
+    /// @brief Writes a response that was sent but not yet written to the socket.
+    void flush();
 
     friend class HttpServerConnection;
 private:
@@ -217,29 +405,53 @@ private:
     StatusCodeType m_StatusCode = 500;
     bool m_UseDefaultReasonPhrase = true;
     bool m_WasSent = false;
+    bool m_DeferSend = false;
+    bool m_Flushed = false;
+    ResponseBody m_Body;
     std::string m_ReasonPhrase;
-    std::vector<std::pair<std::string, std::string>> m_HeaderFields;
+    // Serialized header fields, so that the head of the response is written with a single send.
+    std::string m_HeaderBlock;
+    std::chrono::milliseconds m_SendTimeout{ 0 };
+    MemoryReservation m_Reservation;
 
-    HttpResponse(ClientSocket* socket);
+    HttpResponse(ClientSocket* socket, std::chrono::milliseconds sendTimeout, MemoryBudget* budget);
 };
 
+/// @note Requests and responses refer to the socket of their connection:
+/// the connection must not be moved while they are in use.
 class HttpServerConnection
 {
 public:
+    HttpServerConnection(const HttpServerConnection&) = delete;
+    HttpServerConnection(HttpServerConnection&&) = default;
+
+    /// @brief Receives the next request.
+    /// @note If the request cannot be received, the connection is closed, after answering it in case of an HttpException.
     HttpRequest getNextRequest();
     HttpResponse makeResponse();
 
+    /// @brief Answers a request that could not be received, then closes the connection.
+    /// @note The common rejections are sent from pre-serialized responses.
+    void reject(StatusCode code);
+
     void close();
 
+    HttpServerConnection& operator=(const HttpServerConnection&) = delete;
+    HttpServerConnection& operator=(HttpServerConnection&&) = default;
+
     ~HttpServerConnection();
 
     friend class HttpServer;
 private:
     ClientSocket m_Socket;
+    const HttpServerSettings* m_Settings;
+    MemoryBudget* m_MemoryBudget;
 
-    HttpServerConnection(ClientSocket&& socket);
+    HttpServerConnection(ClientSocket&& socket, const HttpServerSettings* settings, MemoryBudget* budget);
 };
 
+/// @note The connections, requests and responses of the server refer to its settings and memory budget,
+/// so they must be destroyed before it: an executor serving the server must be stopped and destroyed first.
 class HttpServer
 {
 public:
@@ -249,12 +461,19 @@ public:
 
     u16 getPort() const;
 
+    /// @brief Gauge of the memory buffered by the requests and responses of this server.
+    const MemoryBudget& getMemoryBudget() const;
+
     void stop();
 
     ~HttpServer();
 private:
     const HttpServerSettings m_Settings;
     ServerSocket m_Socket;
+    MemoryBudget m_MemoryBudget;
+    // Shared so that the timeouts of connections outliving the server can tell that it is gone.
+    Ref<TimerWheel> m_TimerWheel;
+    std::jthread m_TimerThread;
 };
 
 } // namespace simpleHTTP
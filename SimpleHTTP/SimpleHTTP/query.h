@@ -0,0 +1,51 @@
+#pragma once
+#include <SimpleHTTP/types.h>
+
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace simpleHTTP {
+
+/// @brief Index of the parameters of an application/x-www-form-urlencoded string, such as a query or a form body.
+/// The names and values are views into the string, except those with escapes or '+', which are decoded
+/// into an arena allocated only in that case.
+/// @note The string must outlive the index. Malformed escapes are kept as they are.
+class QueryParameters
+{
+public:
+    using Parameter = std::pair<std::string_view, std::string_view>;
+
+    QueryParameters() = default;
+    explicit QueryParameters(std::string_view text);
+
+    QueryParameters(const QueryParameters&) = delete;
+    QueryParameters(QueryParameters&&) = default;
+
+    /// @brief Returns the first value of the parameter, or nullopt if it is absent.
+    std::optional<std::string_view> get(std::string_view name) const;
+    bool contains(std::string_view name) const;
+
+    u64 size() const;
+    bool empty() const;
+
+    inline auto begin() const {
+        return m_Parameters.begin();
+    }
+
+    inline auto end() const {
+        return m_Parameters.end();
+    }
+
+    QueryParameters& operator=(const QueryParameters&) = delete;
+    QueryParameters& operator=(QueryParameters&&) = default;
+private:
+    std::vector<Parameter> m_Parameters;
+    URef<char[]> m_Arena;
+    u64 m_ArenaSize = 0;
+
+    std::string_view decode(std::string_view text);
+};
+
+} // namespace simpleHTTP
@@ -1,5 +1,7 @@
 #pragma once
 #include <SimpleHTTP/types.h>
+#include <SimpleHTTP/timer.h>
+#include <SimpleHTTP/buffer.h>
 
 #include <string>
 #include <vector>
@@ -30,6 +32,13 @@ public:
     virtual u64 receive(void* buf, u64 size) = 0;
     virtual u64 send(const void* buf, u64 size) = 0;
 
+    /// @brief Blocks until the socket can be read without blocking, or was closed by the peer.
+    virtual void waitReadable() = 0;
+
+    /// @brief Interrupts any blocking operation on the socket.
+    /// @note It can be called from any thread.
+    virtual void shutdown() = 0;
+
     virtual void close() = 0;
 
     virtual inline ~ClientSocketImpl() {}
@@ -48,26 +57,59 @@ public:
     virtual inline ~ServerSocketImpl() {}
 };
 
+/// @note It is move-only: a connection is owned by a single object at a time.
 class ClientSocket
 {
 public:
     ClientSocket(Ref<ClientSocketImpl>&& impl);
+    ClientSocket(const ClientSocket&) = delete;
+    ClientSocket(ClientSocket&&) noexcept = default;
 
     u64 receive(void* buf, u64 size);
 
     inline u64 send(const void* buf, u64 size) {
-        return m_Implementation->send(buf, size);
+        u64 sent = m_Implementation->send(buf, size);
+
+        if (m_RestartTimeoutOnSend) {
+            m_Timeout->restart();
+        }
+
+        return sent;
     }
 
     u64 receiveUntil(void* buf, u64 size, const void* delimiter, u64 delimiterSize);
 
-    inline void close() {
-        m_Implementation->close();
-    }
+    /// @brief Blocks until some data can be received.
+    /// The receive buffer is only acquired once the data is available.
+    /// @return false if the connection was closed.
+    bool waitForData();
+
+    /// @brief Returns the receive buffer to its pool, unless it holds data not yet received.
+    void releaseCache();
+
+    /// @brief Enables the timeouts of the socket, driven by the given wheel.
+    /// @note The socket only holds a weak reference to the wheel, its timeouts stop having effect once it is destroyed.
+    void setTimerWheel(const Ref<TimerWheel>& wheel);
+
+    /// @brief Shuts the socket down if the timeout expires before stopTimeout is called.
+    /// @note It has no effect without a TimerWheel.
+    /// @param restartOnSend If true, the timeout restarts every time some data is sent.
+    void startTimeout(std::chrono::milliseconds timeout, bool restartOnSend = false);
+    void stopTimeout();
+
+    void close();
+
+    ClientSocket& operator=(const ClientSocket&) = delete;
+    ClientSocket& operator=(ClientSocket&&) noexcept = default;
 private:
     Ref<ClientSocketImpl> m_Implementation;
-    std::vector<u8> m_Cache;
-    std::span<u8> m_CacheRange;
+    Buffer m_Cache;
+    u64 m_CacheBegin = 0;
+    u64 m_CacheEnd = 0;
+    URef<Timer> m_Timeout;
+    bool m_RestartTimeoutOnSend = false;
+
+    u64 fillCache();
 };
 
 class ServerSocket
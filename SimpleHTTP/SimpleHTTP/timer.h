@@ -0,0 +1,90 @@
+#pragma once
+#include <SimpleHTTP/types.h>
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <mutex>
+
+namespace simpleHTTP {
+
+class TimerWheel;
+
+/// @brief A timeout that invokes its callback on the thread advancing the TimerWheel.
+/// The timer only holds a weak reference to its wheel, so it may outlive it: it is then disarmed and
+/// its functions have no effect.
+/// @note The callback is invoked while the wheel is locked: it must be short and must not use any timer.
+class Timer
+{
+public:
+    using Callback = std::function<void()>;
+
+    Timer(const Ref<TimerWheel>& wheel, Callback callback);
+    Timer(const Timer&) = delete;
+
+    /// @brief Arms the timer, replacing any previous expiration.
+    /// @note A timeout of 0 only stops the timer.
+    void start(std::chrono::milliseconds timeout);
+
+    /// @brief Arms the timer again with the timeout of the last start.
+    void restart();
+
+    void stop();
+
+    bool isArmed() const;
+
+    Timer& operator=(const Timer&) = delete;
+
+    ~Timer();
+
+    friend class TimerWheel;
+private:
+    WRef<TimerWheel> m_Wheel;
+    Callback m_Callback;
+    std::chrono::milliseconds m_Timeout{ 0 };
+
+    u64 m_Expiration = 0;
+    Timer* m_Previous = nullptr;
+    Timer* m_Next = nullptr;
+    Timer** m_Slot = nullptr;
+};
+
+/// @brief Hierarchical timer wheel: arming and cancelling a timer are O(1).
+class TimerWheel
+{
+public:
+    explicit TimerWheel(std::chrono::milliseconds resolution);
+    TimerWheel(const TimerWheel&) = delete;
+
+    std::chrono::milliseconds getResolution() const;
+
+    /// @brief Expires every timer due up to the current time.
+    void advance();
+
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    ~TimerWheel();
+
+    friend class Timer;
+private:
+    static constexpr u64 SLOT_BITS = 6;
+    static constexpr u64 SLOT_COUNT = 1 << SLOT_BITS;
+    static constexpr u64 SLOT_MASK = SLOT_COUNT - 1;
+    static constexpr u64 LEVEL_COUNT = 4;
+
+    const std::chrono::milliseconds m_Resolution;
+    const std::chrono::steady_clock::time_point m_Start;
+
+    mutable std::mutex m_Mutex;
+    u64 m_CurrentTick = 0;
+    std::array<std::array<Timer*, SLOT_COUNT>, LEVEL_COUNT> m_Slots{};
+
+    void schedule(Timer& timer, std::chrono::milliseconds timeout);
+    void cancel(Timer& timer);
+
+    void insert(Timer& timer);
+    void remove(Timer& timer);
+    void cascade(u64 level);
+};
+
+} // namespace simpleHTTP
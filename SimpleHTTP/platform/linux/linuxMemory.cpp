@@ -0,0 +1,35 @@
+#include <SimpleHTTP/buffer.h>
+
+#include <new>
+#include <sys/mman.h>
+
+namespace simpleHTTP {
+
+u8* BufferPool::allocateSlab(u64 size, bool hugePages) {
+    void* slab = MAP_FAILED;
+
+    if (hugePages) {
+        slab = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+
+    if (slab == MAP_FAILED) {
+        slab = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (slab == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+        if (hugePages) {
+            // No reserved huge pages are available, fall back to transparent huge pages.
+            madvise(slab, size, MADV_HUGEPAGE);
+        }
+    }
+
+    return static_cast<u8*>(slab);
+}
+
+void BufferPool::freeSlab(u8* slab, u64 size) {
+    munmap(slab, size);
+}
+
+} // namespace simpleHTTP
@@ -27,7 +27,8 @@ static inline int acceptSocket(int sockfd, struct sockaddr* addr, socklen_t* add
 }
 
 static inline ssize_t sendSocket(int sockfd, const void* buf, size_t len, int flags) {
-    return send(sockfd, buf, len, flags);
+    // A peer that went away must not raise SIGPIPE, the error is reported by the return value.
+    return send(sockfd, buf, len, flags | MSG_NOSIGNAL);
 }
 
 namespace simpleHTTP {
@@ -153,6 +154,26 @@ u64 LinuxClientSocket::send(const void* buf, u64 size) {
     return result;
 }
 
+void LinuxClientSocket::waitReadable() {
+    pollfd fd{};
+    fd.fd = m_Socket;
+    fd.events = POLLIN;
+
+    while (poll(&fd, 1, -1) < 0) {
+        if (errno != EINTR) {
+            throw std::runtime_error(std::format("Error while waiting for data ({}).", errno));
+        }
+    }
+}
+
+void LinuxClientSocket::shutdown() {
+    if (m_Socket == -1) {
+        return;
+    }
+
+    ::shutdown(m_Socket, SHUT_RDWR);
+}
+
 void LinuxClientSocket::close() {
     if (m_Socket == -1) {
         return;
@@ -219,6 +240,8 @@ void LinuxServerSocket::close() {
         return;
     }
 
+    // Closing the descriptor alone does not wake up the threads blocked in accept.
+    ::shutdown(m_Socket, SHUT_RDWR);
     closeSocket(m_Socket);
     m_Socket = -1;
 }
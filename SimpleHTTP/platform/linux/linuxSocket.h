@@ -17,6 +17,10 @@ public:
     virtual u64 receive(void* buf, u64 size) override;
     virtual u64 send(const void* buf, u64 size) override;
 
+    virtual void waitReadable() override;
+
+    virtual void shutdown() override;
+
     virtual void close() override;
 
     virtual ~LinuxClientSocket() override;
@@ -0,0 +1,39 @@
+#include <SimpleHTTP/buffer.h>
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <new>
+
+namespace simpleHTTP {
+
+u8* BufferPool::allocateSlab(u64 size, bool hugePages) {
+    void* slab = nullptr;
+
+    if (hugePages) {
+        // Large pages require the SeLockMemoryPrivilege and a size multiple of the large page size.
+        const SIZE_T largePageSize = GetLargePageMinimum();
+        if (largePageSize > 0 && size % largePageSize == 0) {
+            slab = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+        }
+    }
+
+    if (!slab) {
+        slab = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    }
+
+    if (!slab) {
+        throw std::bad_alloc();
+    }
+
+    return static_cast<u8*>(slab);
+}
+
+void BufferPool::freeSlab(u8* slab, u64) {
+    // Releasing a reservation frees all of it, the size must be 0.
+    VirtualFree(slab, 0, MEM_RELEASE);
+}
+
+} // namespace simpleHTTP
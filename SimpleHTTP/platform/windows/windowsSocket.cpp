@@ -220,11 +220,28 @@ u64 WindowsClientSocket::send(const void* buf, u64 size) {
     return platformSend(m_Socket, buf, size);
 }
 
+void WindowsClientSocket::waitReadable() {
+    WSAPOLLFD fd{};
+    fd.fd = m_Socket;
+    fd.events = POLLRDNORM;
+
+    if (WSAPoll(&fd, 1, -1) == SOCKET_ERROR) {
+        throw std::runtime_error("WSAPoll failed");
+    }
+}
+
+void WindowsClientSocket::shutdown() {
+    if (m_Socket == INVALID_SOCKET)
+        return;
+
+    ::shutdown(m_Socket, SD_BOTH);
+}
+
 void WindowsClientSocket::close() {
     if (m_Socket == INVALID_SOCKET)
         return;
 
-    shutdown(m_Socket, SD_BOTH);
+    ::shutdown(m_Socket, SD_BOTH);
 
     closesocket(m_Socket);
     m_Socket = INVALID_SOCKET;
@@ -1,8 +1,19 @@
 #include <SimpleHTTP/URI.h>
+#include <hex.h>
 
+#include <algorithm>
 #include <array>
 #include <stdexcept>
 #include <ranges>
+#include <limits>
+#include <bit>
+#include <optional>
+#include <span>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMPLEHTTP_URI_SSE2
+#endif
 
 namespace simpleHTTP {
 
@@ -30,10 +41,6 @@ static constexpr bool isCtr(i8 c) {
     return c == 127 || (c >= 0 && c <= 31);
 }
 
-static constexpr bool isHex(i8 c) {
-    return (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f') || isDigit(c);
-}
-
 static constexpr bool isUnsafe(i8 c) {
     return c == '\"' || c == '#' || c == '%' || c == '<' || c == '>' || c == ' ' || isCtr(c);
 }
@@ -54,6 +61,97 @@ static constexpr bool isPChar(i8 c) {
     return  c == ':' || c == '@' || c == '&' || c == '=' || c == '+' || isUChar(c);
 }
 
+enum CharClass : u8
+{
+    // pchar, without '%' whose escape is checked apart
+    PATH_CHAR = 1 << 0,
+    // pchar, '/' and '?', without '%'
+    QUERY_CHAR = 1 << 1,
+    HEX_CHAR = 1 << 2,
+    SCHEME_CHAR = 1 << 3,
+    // userinfo, host and port: pchar, ';' and the brackets of IP literals, without '%'
+    AUTHORITY_CHAR = 1 << 4
+};
+
+// The predicates above are only evaluated here, at compile time.
+static constexpr std::array<u8, 256> CHAR_CLASSES = [] {
+    std::array<u8, 256> classes{};
+
+    for (u64 i = 0; i < classes.size(); ++i) {
+        const i8 c = static_cast<i8>(i);
+
+        if (isPChar(c)) {
+            classes[i] |= PATH_CHAR | QUERY_CHAR;
+        }
+        if (c == '/' || c == '?') {
+            classes[i] |= QUERY_CHAR;
+        }
+        if (isHex(c)) {
+            classes[i] |= HEX_CHAR;
+        }
+        if (isAlpha(c) || isDigit(c) || c == '+' || c == '-' || c == '.') {
+            classes[i] |= SCHEME_CHAR;
+        }
+        if (isPChar(c) || c == ';' || c == '[' || c == ']') {
+            classes[i] |= AUTHORITY_CHAR;
+        }
+    }
+
+    return classes;
+}();
+
+template<u8 Class>
+static constexpr bool hasClass(i8 c) {
+    return (CHAR_CLASSES[static_cast<u8>(c)] & Class) != 0;
+}
+
+/// @brief Returns the offset of the first character from begin that is not of the class, or the size of the text.
+/// Paths and queries are scanned 16 bytes at a time where SSE2 is available.
+template<u8 Class>
+static u64 skipChars(std::string_view text, u64 begin) {
+    u64 i = begin;
+
+#ifdef SIMPLEHTTP_URI_SSE2
+    if constexpr (Class == PATH_CHAR || Class == QUERY_CHAR) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i firstPrintable = _mm_set1_epi8(0x21);
+
+        for (; i + 16 <= text.size(); i += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+
+            const auto matches = [chunk](i8 c) {
+                return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(c));
+            };
+
+            // Control characters and spaces, while bytes from 0x80 are national characters.
+            __m128i invalid = _mm_andnot_si128(_mm_cmplt_epi8(chunk, zero), _mm_cmplt_epi8(chunk, firstPrintable));
+            invalid = _mm_or_si128(invalid, _mm_or_si128(matches('\x7f'), matches('"')));
+            invalid = _mm_or_si128(invalid, _mm_or_si128(matches('#'), matches('%')));
+            invalid = _mm_or_si128(invalid, _mm_or_si128(matches('<'), matches('>')));
+            invalid = _mm_or_si128(invalid, matches(';'));
+
+            if constexpr (Class == PATH_CHAR) {
+                invalid = _mm_or_si128(invalid, _mm_or_si128(matches('/'), matches('?')));
+            }
+
+            if (const u32 mask = static_cast<u32>(_mm_movemask_epi8(invalid))) {
+                return i + std::countr_zero(mask);
+            }
+        }
+    }
+#endif
+
+    while (i < text.size() && hasClass<Class>(text[i])) {
+        ++i;
+    }
+
+    return i;
+}
+
+static constexpr bool isValidEscape(std::string_view text, u64 percent) {
+    return percent + 2 < text.size() && hasClass<HEX_CHAR>(text[percent + 1]) && hasClass<HEX_CHAR>(text[percent + 2]);
+}
+
 class URIBuilder
 {
 public:
@@ -147,9 +245,7 @@ bool URIBuilder::build(std::string_view _input) {
         u64 beginScheme = getOffset();
         pop();
 
-        while (hasNext() && peek([](i8 c) {
-            return isAlpha(c) || isDigit(c) || c == '+' || c == '-' || c == '.';
-        })) {
+        while (hasNext() && peek(hasClass<SCHEME_CHAR>)) {
             pop();
         }
 
@@ -188,7 +284,7 @@ bool URIBuilder::build(std::string_view _input) {
     }
 
     auto isFragmentChar = [](i8 c) {
-        return isPChar(c) || c == '%';
+        return hasClass<PATH_CHAR>(c) || c == '%';
     };
 
     if (!isAbempty) {
@@ -198,10 +294,10 @@ bool URIBuilder::build(std::string_view _input) {
 
         if (peek() == '%') {
             pop();
-            if (!hasNext() || !peek(isHex))
+            if (!hasNext() || !peek(hasClass<HEX_CHAR>))
                 return false;
             pop();
-            if (!hasNext() || !peek(isHex))
+            if (!hasNext() || !peek(hasClass<HEX_CHAR>))
                 return false;
         }
 
@@ -211,10 +307,10 @@ bool URIBuilder::build(std::string_view _input) {
         while (hasNext() && peek(isFragmentChar)) {
             if (peek() == '%') {
                 pop();
-                if (!hasNext() || !peek(isHex))
+                if (!hasNext() || !peek(hasClass<HEX_CHAR>))
                     return false;
                 pop();
-                if (!hasNext() || !peek(isHex))
+                if (!hasNext() || !peek(hasClass<HEX_CHAR>))
                     return false;
             }
             pop();
@@ -235,10 +331,10 @@ bool URIBuilder::build(std::string_view _input) {
         while (hasNext() && peek(isFragmentChar)) {
             if (peek() == '%') {
                 pop();
-                if (!hasNext() || !peek(isHex))
+                if (!hasNext() || !peek(hasClass<HEX_CHAR>))
                     return false;
                 pop();
-                if (!hasNext() || !peek(isHex))
+                if (!hasNext() || !peek(hasClass<HEX_CHAR>))
                     return false;
             }
             pop();
@@ -254,9 +350,7 @@ bool URIBuilder::build(std::string_view _input) {
     if (hasNext() && peek() == '?') {
         pop();
         u64 beginQuery = getOffset();
-        while (hasNext() && peek([](i8 c) {
-            return isPChar(c) || c == '/' || c == '?';
-        })) {
+        while (hasNext() && peek(hasClass<QUERY_CHAR>)) {
             pop();
         }
 
@@ -273,9 +367,7 @@ bool URIBuilder::build(std::string_view _input) {
     pop();
 
     u64 beginFragment = getOffset();
-    while (hasNext() && peek([](i8 c) {
-        return isPChar(c) || c == '/' || c == '?';
-    })) {
+    while (hasNext() && peek(hasClass<QUERY_CHAR>)) {
         pop();
     }
 
@@ -405,58 +497,395 @@ std::string URI::toString() const {
 
 URI::~URI() {}
 
-}
+/// @brief Checks the characters of a query or fragment, up to the end or the given terminator.
+/// @return The offset of the terminator, or npos if a character is invalid.
+static u64 validateComponent(std::string_view target, u64 begin, i8 terminator) {
+    u64 i = begin;
+    while ((i = skipChars<QUERY_CHAR>(target, i)) < target.size() && target[i] != terminator) {
+        if (target[i] != '%' || !isValidEscape(target, i)) {
+            return std::string_view::npos;
+        }
+        i += 3;
+    }
 
-std::filesystem::path operator/(const std::filesystem::path& path, const simpleHTTP::URI& uri) {
-    auto segment = uri.getSegmentsSection();
+    return i;
+}
 
-    if (segment.size() < 1) {
-        return path;
+URIView::URIView(std::string_view target)
+    : m_Raw(target) {
+    if (target.empty() || target.size() > std::numeric_limits<u32>::max()) {
+        throw std::runtime_error("Invalid URI!");
     }
 
-    std::string filterSegment;
+    u64 i = 0;
+    if (target.front() != '/') {
+        // absolute-form: scheme "://" authority path-abempty
+        if (!isAlpha(target.front())) {
+            throw std::runtime_error("Invalid URI!");
+        }
+
+        i = skipChars<SCHEME_CHAR>(target, 0);
 
-    constexpr auto hexToHChar = [](char c) -> char {
-        if (c >= '0' && c <= '9') {
-            return c - '0';
+        if (target.substr(i, 3) != "://") {
+            throw std::runtime_error("Invalid URI!");
         }
 
-        if (c >= 'a' && c <= 'f') {
-            return c - 'a' + 10;
+        m_SchemeEnd = static_cast<u32>(i);
+        i += 3;
+        m_AuthorityBegin = static_cast<u32>(i);
+
+        while ((i = skipChars<AUTHORITY_CHAR>(target, i)) < target.size()
+            && target[i] != '/' && target[i] != '?' && target[i] != '#') {
+            if (target[i] != '%' || !isValidEscape(target, i)) {
+                throw std::runtime_error("Invalid URI!");
+            }
+            i += 3;
         }
+    }
+
+    m_PathBegin = static_cast<u32>(i);
 
-        if (c >= 'A' && c <= 'F') {
-            return c - 'A' + 10;
+    u64 segmentBegin = i;
+    const auto closeSegment = [this, &segmentBegin](u64 end) {
+        if (end == segmentBegin) {
+            return;
         }
 
-        return 0;
-    };
+        const Range segment{ static_cast<u32>(segmentBegin), static_cast<u32>(end) };
+        if (m_SegmentCount == 0) {
+            m_SegmentsSection.first = segment.first;
+        }
+        m_SegmentsSection.second = segment.second;
 
-    constexpr auto hexToChar = [](char c1, char c2) -> char {
-        return hexToHChar(c1) << 4 | hexToHChar(c2);
+        if (m_SegmentCount < INLINE_SEGMENT_COUNT) {
+            m_Segments[m_SegmentCount] = segment;
+        }
+        ++m_SegmentCount;
     };
 
-    constexpr auto isSafePathChar = [](char c) -> bool {
-        return simpleHTTP::isAlpha(c) || simpleHTTP::isDigit(c) || c == ' ' || c < 0;
-    };
+    while ((i = skipChars<PATH_CHAR>(target, i)) < target.size() && target[i] != '?' && target[i] != '#') {
+        const i8 c = target[i];
 
-    auto c = segment.begin();
-    for (; c != segment.end(); ++c) {
-        if (*c != '%') {
-            filterSegment.push_back(*c);
+        if (c == '/') {
+            closeSegment(i);
+            segmentBegin = ++i;
             continue;
         }
 
-        ++c;
-        char c1 = *c;
-        ++c;
-        char c2 = *c;
+        if (c != '%' || !isValidEscape(target, i)) {
+            throw std::runtime_error("Invalid URI!");
+        }
+        i += 3;
+    }
+
+    closeSegment(i);
+    m_PathEnd = static_cast<u32>(i);
+
+    // The query and fragment are only checked here, they are located again when asked for.
+    if (i < target.size() && target[i] == '?') {
+        i = validateComponent(target, i + 1, '#');
+    }
+
+    if (i != std::string_view::npos && i < target.size()) {
+        i = validateComponent(target, i + 1, '#');
+    }
+
+    if (i != target.size()) {
+        throw std::runtime_error("Invalid URI!");
+    }
+}
+
+std::string_view URIView::getScheme() const {
+    return m_Raw.substr(0, m_SchemeEnd);
+}
+
+std::string_view URIView::getAuthority() const {
+    return m_Raw.substr(m_AuthorityBegin, m_PathBegin - m_AuthorityBegin);
+}
+
+std::string_view URIView::getPath() const {
+    return m_Raw.substr(m_PathBegin, m_PathEnd - m_PathBegin);
+}
+
+u64 URIView::getSegmentCount() const {
+    return m_SegmentCount;
+}
+
+std::string_view URIView::getSegment(u64 index) const {
+    if (index >= m_SegmentCount) {
+        return std::string_view();
+    }
+
+    if (index < INLINE_SEGMENT_COUNT) {
+        const Range segment = m_Segments[index];
+        return m_Raw.substr(segment.first, segment.second - segment.first);
+    }
+
+    // Past the inline segments, the path is split again from the last of them.
+    std::string_view path = m_Raw.substr(m_Segments.back().second, m_PathEnd - m_Segments.back().second);
+    std::string_view segment;
+    for (u64 i = INLINE_SEGMENT_COUNT - 1; i < index;) {
+        const auto begin = path.find_first_not_of('/');
+        const auto end = path.find('/', begin);
+        segment = path.substr(begin, end - begin);
+        path = end == std::string_view::npos ? std::string_view() : path.substr(end);
+        ++i;
+    }
+
+    return segment;
+}
+
+std::vector<std::string_view> URIView::getSegments() const {
+    std::vector<std::string_view> segments;
+    segments.reserve(m_SegmentCount);
+
+    for (u64 i = 0; i < m_SegmentCount; ++i) {
+        segments.push_back(getSegment(i));
+    }
+
+    return segments;
+}
+
+std::string_view URIView::getSegmentsSection() const {
+    return m_Raw.substr(m_SegmentsSection.first, m_SegmentsSection.second - m_SegmentsSection.first);
+}
+
+std::string_view URIView::getQuery() const {
+    if (m_PathEnd == m_Raw.size() || m_Raw[m_PathEnd] != '?') {
+        return std::string_view();
+    }
+
+    const std::string_view query = m_Raw.substr(m_PathEnd + 1);
+    return query.substr(0, query.find('#'));
+}
+
+std::string_view URIView::getFragment() const {
+    const auto hash = m_Raw.find('#', m_PathEnd);
 
-        char r = hexToChar(c1, c2);
-        if (isSafePathChar(r)) {
-            filterSegment.push_back(r);
+    if (hash == std::string_view::npos) {
+        return std::string_view();
+    }
+
+    return m_Raw.substr(hash + 1);
+}
+
+std::string_view URIView::getRaw() const {
+    return m_Raw;
+}
+
+std::string URIView::toString() const {
+    return std::string(m_Raw);
+}
+
+/// @brief Characters of a path that may change how it is mapped to the filesystem.
+static constexpr bool isPathMappingSpecial(u8 c) {
+    return c < 0x20 || c == 0x7f || c == '/' || c == '\\' || c == ':';
+}
+
+std::optional<u64> decodePath(std::string_view path, std::span<char> buffer) {
+    if (buffer.size() < path.size()) {
+        return std::nullopt;
+    }
+
+    u64 out = 0;
+    u64 segmentBegin = 0;
+
+    // A segment is checked once decoded, so that escaped dots are caught too.
+    const auto closeSegment = [&buffer, &out, &segmentBegin] {
+        const std::string_view segment(buffer.data() + segmentBegin, out - segmentBegin);
+        return segment != "." && segment != "..";
+    };
+
+    u64 i = 0;
+    while (i < path.size()) {
+#ifdef SIMPLEHTTP_URI_SSE2
+        // Runs of plain characters are copied 16 bytes at a time, the output never being ahead of the input.
+        // Consecutive escapes, as in encoded UTF-8, are left to the scalar loop without testing a chunk.
+        for (; i + 16 <= path.size() && path[i] != '%'; ) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(path.data() + i));
+
+            const auto matches = [chunk](i8 c) {
+                return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(c));
+            };
+
+            __m128i special = _mm_andnot_si128(_mm_cmplt_epi8(chunk, _mm_setzero_si128()),
+                _mm_cmplt_epi8(chunk, _mm_set1_epi8(0x20)));
+            special = _mm_or_si128(special, _mm_or_si128(matches('\x7f'), matches('%')));
+            special = _mm_or_si128(special, _mm_or_si128(matches('/'), matches('\\')));
+            special = _mm_or_si128(special, matches(':'));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(buffer.data() + out), chunk);
+
+            const u32 mask = static_cast<u32>(_mm_movemask_epi8(special));
+            const u64 plain = mask ? std::countr_zero(mask) : 16;
+            i += plain;
+            out += plain;
+
+            if (mask) {
+                break;
+            }
+        }
+
+        if (i >= path.size()) {
+            break;
+        }
+#endif
+
+        const i8 c = path[i];
+
+        if (c == '%') {
+            if (!isValidEscape(path, i)) {
+                return std::nullopt;
+            }
+
+            const u8 decoded = static_cast<u8>(hexValue(path[i + 1]) << 4 | hexValue(path[i + 2]));
+            if (isPathMappingSpecial(decoded)) {
+                return std::nullopt;
+            }
+
+            buffer[out++] = static_cast<char>(decoded);
+            i += 3;
+        }
+        else if (c == '/') {
+            // Empty segments are dropped.
+            if (out > segmentBegin) {
+                if (!closeSegment()) {
+                    return std::nullopt;
+                }
+
+                buffer[out++] = '/';
+                segmentBegin = out;
+            }
+            ++i;
+        }
+        else if (isPathMappingSpecial(static_cast<u8>(c))) {
+            return std::nullopt;
+        }
+        else {
+            buffer[out++] = c;
+            ++i;
+        }
+    }
+
+    if (!closeSegment()) {
+        return std::nullopt;
+    }
+
+    if (out > 0 && buffer[out - 1] == '/') {
+        --out;
+    }
+
+    return out;
+}
+
+u64 removeDotSegments(char* target, u64 length) {
+    const std::string_view view(target, length);
+
+    u64 pathBegin = 0;
+    if (!view.starts_with('/')) {
+        const auto authority = view.find("://");
+        if (authority == std::string_view::npos) {
+            return length;
+        }
+
+        pathBegin = view.find_first_of("/?#", authority + 3);
+        if (pathBegin == std::string_view::npos || view[pathBegin] != '/') {
+            return length;
+        }
+    }
+
+    const u64 pathEnd = std::min<u64>(view.find_first_of("?#", pathBegin), length);
+    const std::string_view path = view.substr(pathBegin, pathEnd - pathBegin);
+
+    if (path.find("/.") == std::string_view::npos) {
+        return length;
+    }
+
+    // Each "/segment" is copied down over the removed ones, which the output never outgrows.
+    u64 out = pathBegin;
+    u64 i = pathBegin;
+    while (i < pathEnd) {
+        const u64 segmentEnd = std::min<u64>(view.find('/', i + 1), pathEnd);
+        const std::string_view segment = view.substr(i + 1, segmentEnd - i - 1);
+
+        if (segment == "..") {
+            while (out > pathBegin && target[--out] != '/');
+        }
+        else if (segment != ".") {
+            std::copy(target + i, target + segmentEnd, target + out);
+            out += segmentEnd - i;
         }
+
+        i = segmentEnd;
     }
 
-    return path / filterSegment;
+    if (out == pathBegin) {
+        target[out++] = '/';
+    }
+
+    std::copy(target + pathEnd, target + length, target + out);
+    return out + (length - pathEnd);
+}
+
+bool PathParameters::add(std::string_view name, std::string_view value) {
+    if (m_Size == CAPACITY) {
+        return false;
+    }
+
+    m_Parameters[m_Size++] = { name, value };
+    return true;
+}
+
+std::string_view PathParameters::get(std::string_view name) const {
+    for (const auto& [parameterName, value] : *this) {
+        if (parameterName == name) {
+            return value;
+        }
+    }
+
+    return std::string_view();
+}
+
+bool PathParameters::contains(std::string_view name) const {
+    return std::ranges::any_of(*this, [name](const Parameter& parameter) {
+        return parameter.first == name;
+    });
+}
+
+u64 PathParameters::size() const {
+    return m_Size;
+}
+
+bool PathParameters::empty() const {
+    return m_Size == 0;
+}
+
+void PathParameters::clear() {
+    m_Size = 0;
+}
+
+}
+
+static std::filesystem::path appendSegments(const std::filesystem::path& path, std::string_view section) {
+    if (section.empty()) {
+        return path;
+    }
+
+    std::string decoded(section.size(), '\0');
+    const auto length = simpleHTTP::decodePath(section, decoded);
+
+    if (!length) {
+        throw std::runtime_error("Invalid path!");
+    }
+
+    decoded.resize(*length);
+    return path / decoded;
+}
+
+std::filesystem::path operator/(const std::filesystem::path& path, const simpleHTTP::URI& uri) {
+    return appendSegments(path, uri.getSegmentsSection());
+}
+
+std::filesystem::path operator/(const std::filesystem::path& path, const simpleHTTP::URIView& uri) {
+    return appendSegments(path, uri.getSegmentsSection());
 }
@@ -0,0 +1,100 @@
+#include <SimpleHTTP/budget.h>
+
+#include <utility>
+
+namespace simpleHTTP {
+
+MemoryBudget::MemoryBudget(u64 limit)
+    : m_Limit(limit) {}
+
+bool MemoryBudget::tryReserve(u64 size) {
+    if (m_Limit == 0) {
+        reserve(size);
+        return true;
+    }
+
+    u64 usage = m_Usage.load(std::memory_order_relaxed);
+    do {
+        if (size > m_Limit || usage > m_Limit - size) {
+            return false;
+        }
+    } while (!m_Usage.compare_exchange_weak(usage, usage + size, std::memory_order_relaxed));
+
+    return true;
+}
+
+void MemoryBudget::reserve(u64 size) {
+    m_Usage.fetch_add(size, std::memory_order_relaxed);
+}
+
+void MemoryBudget::release(u64 size) {
+    m_Usage.fetch_sub(size, std::memory_order_relaxed);
+}
+
+u64 MemoryBudget::getUsage() const {
+    return m_Usage.load(std::memory_order_relaxed);
+}
+
+u64 MemoryBudget::getLimit() const {
+    return m_Limit;
+}
+
+MemoryReservation::MemoryReservation(MemoryBudget* budget)
+    : m_Budget(budget) {}
+
+MemoryReservation::MemoryReservation(MemoryReservation&& other) noexcept
+    : m_Budget(std::exchange(other.m_Budget, nullptr)), m_Size(std::exchange(other.m_Size, 0)) {}
+
+bool MemoryReservation::tryGrow(u64 size) {
+    if (!m_Budget) {
+        return true;
+    }
+
+    if (!m_Budget->tryReserve(size)) {
+        return false;
+    }
+
+    m_Size += size;
+    return true;
+}
+
+void MemoryReservation::grow(u64 size) {
+    if (!m_Budget) {
+        return;
+    }
+
+    m_Budget->reserve(size);
+    m_Size += size;
+}
+
+void MemoryReservation::clear() {
+    if (m_Budget) {
+        m_Budget->release(m_Size);
+    }
+
+    m_Size = 0;
+}
+
+u64 MemoryReservation::size() const {
+    return m_Size;
+}
+
+MemoryReservation& MemoryReservation::operator=(MemoryReservation&& other) noexcept {
+    if (this != &other) {
+        if (m_Budget) {
+            m_Budget->release(m_Size);
+        }
+
+        m_Budget = std::exchange(other.m_Budget, nullptr);
+        m_Size = std::exchange(other.m_Size, 0);
+    }
+    return *this;
+}
+
+MemoryReservation::~MemoryReservation() {
+    if (m_Budget) {
+        m_Budget->release(m_Size);
+    }
+}
+
+} // namespace simpleHTTP
@@ -0,0 +1,239 @@
+#include <SimpleHTTP/buffer.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace simpleHTTP {
+
+static constexpr u64 MIN_BLOCK_BITS = std::bit_width(BufferPool::MIN_BLOCK_SIZE) - 1;
+static constexpr u64 SIZE_CLASS_COUNT = std::bit_width(BufferPool::MAX_BLOCK_SIZE) - MIN_BLOCK_BITS;
+
+static_assert(std::has_single_bit(BufferPool::MIN_BLOCK_SIZE) && std::has_single_bit(BufferPool::MAX_BLOCK_SIZE));
+static_assert(BufferPool::SLAB_SIZE >= BufferPool::MAX_BLOCK_SIZE);
+
+static constexpr u64 getSizeClass(u64 size) {
+    return std::bit_width(std::max(size, BufferPool::MIN_BLOCK_SIZE) - 1) - MIN_BLOCK_BITS;
+}
+
+static constexpr u64 getClassSize(u64 sizeClass) {
+    return BufferPool::MIN_BLOCK_SIZE << sizeClass;
+}
+
+struct SharedBlockLists
+{
+    std::array<std::mutex, SIZE_CLASS_COUNT> mutexes;
+    std::array<std::vector<u8*>, SIZE_CLASS_COUNT> blocks;
+    // Slabs carved into the blocks of each size class, so that trim can find the ones entirely free.
+    std::array<std::vector<u8*>, SIZE_CLASS_COUNT> slabs;
+
+    std::atomic<bool> useHugePages = false;
+    std::atomic<u64> threadCacheSize = BufferPoolSettings{}.threadCacheSize;
+};
+
+// Never destroyed, since the thread caches give their blocks back when the threads exit.
+static SharedBlockLists& getSharedBlockLists() {
+    static SharedBlockLists* lists = new SharedBlockLists();
+    return *lists;
+}
+
+static void moveBlocks(std::vector<u8*>& from, std::vector<u8*>& to, u64 count) {
+    count = std::min<u64>(count, from.size());
+    to.insert(to.end(), from.end() - count, from.end());
+    from.resize(from.size() - count);
+}
+
+/// @brief Carves a new slab into the shared list of the size class, whose mutex must be held.
+static void addSlab(SharedBlockLists& shared, u64 sizeClass, u8* slab) {
+    const u64 blockSize = getClassSize(sizeClass);
+
+    shared.slabs[sizeClass].push_back(slab);
+    for (u64 offset = 0; offset + blockSize <= BufferPool::SLAB_SIZE; offset += blockSize) {
+        shared.blocks[sizeClass].push_back(slab + offset);
+    }
+}
+
+static thread_local bool t_ThreadBlockCacheDestroyed = false;
+
+class ThreadBlockCache
+{
+public:
+    ThreadBlockCache() {
+        const u64 cacheSize = getSharedBlockLists().threadCacheSize;
+
+        for (u64 i = 0; i < SIZE_CLASS_COUNT; ++i) {
+            m_Capacity[i] = std::max<u64>(cacheSize / getClassSize(i), 1);
+            m_Blocks[i].reserve(m_Capacity[i]);
+        }
+    }
+
+    u8* pop(u64 sizeClass) {
+        auto& blocks = m_Blocks[sizeClass];
+
+        if (blocks.empty()) {
+            refill(sizeClass);
+        }
+
+        u8* block = blocks.back();
+        blocks.pop_back();
+        return block;
+    }
+
+    void push(u64 sizeClass, u8* block) {
+        auto& blocks = m_Blocks[sizeClass];
+
+        if (blocks.size() >= m_Capacity[sizeClass]) {
+            auto& shared = getSharedBlockLists();
+            std::scoped_lock lk(shared.mutexes[sizeClass]);
+            moveBlocks(blocks, shared.blocks[sizeClass], (blocks.size() + 1) / 2);
+        }
+
+        blocks.push_back(block);
+    }
+
+    ~ThreadBlockCache() {
+        auto& shared = getSharedBlockLists();
+
+        for (u64 i = 0; i < SIZE_CLASS_COUNT; ++i) {
+            std::scoped_lock lk(shared.mutexes[i]);
+            moveBlocks(m_Blocks[i], shared.blocks[i], m_Blocks[i].size());
+        }
+
+        t_ThreadBlockCacheDestroyed = true;
+    }
+private:
+    std::array<std::vector<u8*>, SIZE_CLASS_COUNT> m_Blocks;
+    std::array<u64, SIZE_CLASS_COUNT> m_Capacity{};
+
+    void refill(u64 sizeClass) {
+        auto& shared = getSharedBlockLists();
+        std::scoped_lock lk(shared.mutexes[sizeClass]);
+
+        auto& sharedBlocks = shared.blocks[sizeClass];
+        if (sharedBlocks.empty()) {
+            addSlab(shared, sizeClass, BufferPool::allocateSlab(BufferPool::SLAB_SIZE, shared.useHugePages));
+        }
+
+        moveBlocks(sharedBlocks, m_Blocks[sizeClass], std::max<u64>(m_Capacity[sizeClass] / 2, 1));
+    }
+};
+
+static ThreadBlockCache* getThreadBlockCache() {
+    if (t_ThreadBlockCacheDestroyed) {
+        return nullptr;
+    }
+
+    thread_local ThreadBlockCache cache;
+    return &cache;
+}
+
+Buffer::Buffer(u8* data, u64 size)
+    : m_Data(data), m_Size(size) {}
+
+Buffer::Buffer(Buffer&& other) noexcept
+    : m_Data(std::exchange(other.m_Data, nullptr)), m_Size(std::exchange(other.m_Size, 0)) {}
+
+Buffer& Buffer::operator=(Buffer&& other) noexcept {
+    if (this != &other) {
+        if (m_Data) {
+            BufferPool::release(m_Data, m_Size);
+        }
+
+        m_Data = std::exchange(other.m_Data, nullptr);
+        m_Size = std::exchange(other.m_Size, 0);
+    }
+    return *this;
+}
+
+Buffer::~Buffer() {
+    if (m_Data) {
+        BufferPool::release(m_Data, m_Size);
+    }
+}
+
+Buffer BufferPool::acquire(u64 size) {
+    if (size > MAX_BLOCK_SIZE) {
+        return Buffer(new u8[size], size);
+    }
+
+    const u64 sizeClass = getSizeClass(size);
+
+    if (ThreadBlockCache* cache = getThreadBlockCache()) {
+        return Buffer(cache->pop(sizeClass), getClassSize(sizeClass));
+    }
+
+    // The thread is exiting, borrow directly from the shared lists.
+    auto& shared = getSharedBlockLists();
+    std::scoped_lock lk(shared.mutexes[sizeClass]);
+
+    auto& sharedBlocks = shared.blocks[sizeClass];
+    if (sharedBlocks.empty()) {
+        addSlab(shared, sizeClass, allocateSlab(SLAB_SIZE, shared.useHugePages));
+    }
+
+    u8* block = sharedBlocks.back();
+    sharedBlocks.pop_back();
+    return Buffer(block, getClassSize(sizeClass));
+}
+
+void BufferPool::configure(const BufferPoolSettings& settings) {
+    auto& shared = getSharedBlockLists();
+    shared.useHugePages = settings.useHugePages;
+    shared.threadCacheSize = settings.threadCacheSize;
+}
+
+u64 BufferPool::trim() {
+    auto& shared = getSharedBlockLists();
+    u64 freedSlabs = 0;
+
+    for (u64 sizeClass = 0; sizeClass < SIZE_CLASS_COUNT; ++sizeClass) {
+        std::scoped_lock lk(shared.mutexes[sizeClass]);
+
+        auto& blocks = shared.blocks[sizeClass];
+        auto& slabs = shared.slabs[sizeClass];
+        const u64 blocksPerSlab = SLAB_SIZE / getClassSize(sizeClass);
+
+        // Sorted, the blocks of a slab are contiguous in the list, and all of them are there if it is free.
+        std::ranges::sort(blocks);
+
+        std::erase_if(slabs, [&blocks, &freedSlabs, blocksPerSlab](u8* slab) {
+            const auto first = std::ranges::lower_bound(blocks, slab);
+            const auto last = std::ranges::lower_bound(first, blocks.end(), slab + SLAB_SIZE);
+
+            if (static_cast<u64>(last - first) != blocksPerSlab) {
+                return false;
+            }
+
+            blocks.erase(first, last);
+            freeSlab(slab, SLAB_SIZE);
+            ++freedSlabs;
+            return true;
+        });
+    }
+
+    return freedSlabs;
+}
+
+void BufferPool::release(u8* data, u64 size) {
+    if (size > MAX_BLOCK_SIZE) {
+        delete[] data;
+        return;
+    }
+
+    const u64 sizeClass = getSizeClass(size);
+
+    if (ThreadBlockCache* cache = getThreadBlockCache()) {
+        cache->push(sizeClass, data);
+        return;
+    }
+
+    auto& shared = getSharedBlockLists();
+    std::scoped_lock lk(shared.mutexes[sizeClass]);
+    shared.blocks[sizeClass].push_back(data);
+}
+
+} // namespace simpleHTTP
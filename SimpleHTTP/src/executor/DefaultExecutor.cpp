@@ -2,11 +2,105 @@
 
 #include <algorithm>
 #include <iterator>
+#include <numeric>
 #include <iostream>
 
 namespace simpleHTTP {
 
-DefaultExecutor::DefaultExecutor() {}
+RequestCompletion::RequestCompletion(HttpServerConnection&& connection)
+    : m_Connection(std::move(connection)),
+    m_Request(m_Connection.getNextRequest()),
+    m_Response(m_Connection.makeResponse()) {
+    m_Response.setVersion(m_Request.getVersion());
+}
+
+const HttpRequest& RequestCompletion::getRequest() const {
+    return m_Request;
+}
+
+HttpResponse& RequestCompletion::getResponse() {
+    return m_Response;
+}
+
+void RequestCompletion::complete(bool success) {
+    if (!markCompleted(success)) {
+        return;
+    }
+
+    if (m_ExecutorLink) {
+        // The response is written back on one of the I/O threads, if the executor still exists and runs.
+        std::shared_lock lk(m_ExecutorLink->mutex);
+
+        if (m_ExecutorLink->executor && m_ExecutorLink->executor->scheduleWrite(shared_from_this())) {
+            return;
+        }
+    }
+
+    finish();
+}
+
+bool RequestCompletion::isCompleted() const {
+    return m_Completed;
+}
+
+RequestCompletion::~RequestCompletion() {
+    if (markCompleted(false)) {
+        finish();
+    }
+}
+
+bool RequestCompletion::markCompleted(bool success) {
+    if (m_Completed.exchange(true)) {
+        return false;
+    }
+
+    if (!success && !m_Response.wasSent()) {
+        // Failure
+        m_Response.setStatusCode(StatusCode::INTERNAL_SERVER_ERROR);
+        m_Response.clearHeaderFields();
+        m_Response.generateDefaultReasonPhrase();
+    }
+
+    return true;
+}
+
+void RequestCompletion::finish() {
+    try {
+        if (!m_Response.wasSent()) {
+            m_Response.send();
+        }
+
+        m_Response.flush();
+    } catch (const std::exception& ex) {
+        // TODO: Proper Logging
+        std::cout << ex.what() << std::endl;
+    } catch (...) {
+        // TODO: Proper Logging
+        std::cout << "Unrecognized Exception" << std::endl;
+    }
+
+    m_Connection.close();
+}
+
+DefaultExecutor::DefaultExecutor()
+    : DefaultExecutor(DefaultExecutorSettings{}) {}
+
+DefaultExecutor::DefaultExecutor(DefaultExecutorSettings settings)
+    : m_Settings(std::move(settings)),
+    m_CompletionLink(makeRef<RequestCompletion::ExecutorLink>()),
+    m_Lanes(std::max<std::size_t>(m_Settings.lanes.size(), 1)) {
+    m_CompletionLink->executor = this;
+
+    for (std::size_t i = 0; i < m_Settings.lanes.size(); ++i) {
+        m_Lanes[i].settings = m_Settings.lanes[i];
+    }
+
+    m_LaneOrder.resize(m_Lanes.size());
+    std::iota(m_LaneOrder.begin(), m_LaneOrder.end(), 0u);
+    std::stable_sort(m_LaneOrder.begin(), m_LaneOrder.end(), [this](u32 a, u32 b) {
+        return m_Lanes[a].settings.priority > m_Lanes[b].settings.priority;
+    });
+}
 
 void DefaultExecutor::run(HttpServer& server) {
     {
@@ -19,7 +113,13 @@ void DefaultExecutor::run(HttpServer& server) {
         m_Started = true;
     }
 
-    setup();
+    try {
+        setup();
+    } catch (...) {
+        std::scoped_lock lk(m_StateMutex);
+        m_Started = false;
+        throw;
+    }
 
     while (!m_StopSource.stop_requested()) {
         std::optional<HttpServerConnection> connection = std::nullopt;
@@ -40,7 +140,7 @@ void DefaultExecutor::run(HttpServer& server) {
 
         {
             std::lock_guard lk(m_StagedConnectionMutex);
-            m_StagedConnection = connection;
+            m_StagedConnection = std::move(connection);
         }
         m_StagedConnectionCV.notify_one();
     }
@@ -50,91 +150,314 @@ void DefaultExecutor::run(HttpServer& server) {
 
 void DefaultExecutor::stop() {
     m_StopSource.request_stop();
+
+    {
+        std::lock_guard lk(m_StagedConnectionMutex);
+    }
+    m_StagedConnectionCV.notify_all();
+
+    {
+        std::lock_guard lk(m_PendingRequestsMutex);
+    }
+    m_PendingRequestsCV.notify_all();
+    for (auto& lane : m_Lanes) {
+        lane.reservedCV.notify_all();
+    }
 }
 
 void DefaultExecutor::setup() {
     std::scoped_lock lk(m_StateMutex);
 
-    if (m_Threads.size() < static_cast<std::size_t>(m_MinThread)) {
-        m_Threads.reserve(m_MinThread);
-        std::generate_n(std::back_inserter(m_Threads),
-                        static_cast<std::size_t>(m_MinThread) - m_Threads.size(),
-                        [this] {
-            return std::jthread(processConnections, m_StopSource.get_token(), this);
+    const u32 ioThreads = std::max(m_Settings.ioThreads, 1u);
+    const u32 newIoThreads = ioThreads - std::min(static_cast<u32>(m_Threads.size()), ioThreads);
+
+    // Lane served by each compute thread to start.
+    std::vector<u32> computeLanes;
+    if (m_Settings.computeThreads > 0 && m_ComputeThreads.empty()) {
+        u32 reservedThreads = 0;
+        for (u32 i = 0; i < static_cast<u32>(m_Lanes.size()); ++i) {
+            computeLanes.insert(computeLanes.end(), m_Lanes[i].settings.reservedThreads, i);
+            reservedThreads += m_Lanes[i].settings.reservedThreads;
+        }
+
+        // Lanes without reserved threads must still be served.
+        const u32 sharedThreads = std::max(m_Settings.computeThreads - std::min(m_Settings.computeThreads, reservedThreads), 1u);
+        computeLanes.insert(computeLanes.end(), sharedThreads, SHARED_LANE);
+    }
+
+    // The contexts are made on this thread before any worker starts, so that an exception thrown by
+    // the factory reaches the caller of run instead of terminating the process.
+    std::vector<URef<WorkerContext>> ioContexts(newIoThreads);
+    if (m_Settings.computeThreads == 0) {
+        // I/O threads run the handlers only when there is no compute pool.
+        std::ranges::generate(ioContexts, [this] {
+            return makeWorkerContext();
         });
     }
+
+    std::vector<URef<WorkerContext>> computeContexts(computeLanes.size());
+    std::ranges::generate(computeContexts, [this] {
+        return makeWorkerContext();
+    });
+
+    m_Threads.reserve(ioThreads);
+    for (auto& context : ioContexts) {
+        m_Threads.emplace_back(processConnections, m_StopSource.get_token(), this, std::move(context));
+    }
+
+    m_ComputeThreads.reserve(computeLanes.size());
+    for (u64 i = 0; i < computeLanes.size(); ++i) {
+        m_ComputeThreads.emplace_back(processRequests, m_StopSource.get_token(), this, computeLanes[i],
+            std::move(computeContexts[i]));
+    }
 }
 
-void DefaultExecutor::processConnections(std::stop_token threadStopToken, std::stop_token executorStopToken, DefaultExecutor* executor) {
+void DefaultExecutor::processConnections(std::stop_token threadStopToken, std::stop_token executorStopToken,
+    DefaultExecutor* executor, URef<WorkerContext> context) {
     while (!(threadStopToken.stop_requested() || executorStopToken.stop_requested())) {
-        executor->processConnectionsImpl();
+        executor->processConnectionsImpl(context.get());
     }
 }
 
-void DefaultExecutor::processConnectionsImpl() {
+void DefaultExecutor::processConnectionsImpl(WorkerContext* context) {
     std::optional<HttpServerConnection> connection = std::nullopt;
+    Ref<RequestCompletion> pendingWrite;
     {
         std::unique_lock lk(m_StagedConnectionMutex);
         m_StagedConnectionCV.wait(lk, [this] {
-            return m_StagedConnection.has_value() || m_StopSource.stop_requested();
+            return m_StagedConnection.has_value() || !m_PendingWrites.empty() || m_StopSource.stop_requested();
         });
 
         if (m_StopSource.stop_requested()) {
+            lk.unlock();
+            finishPendingWrites();
             return;
         }
 
-        m_StagedConnection.swap(connection);
+        // Responses are written first, so that finished requests release their connection.
+        if (!m_PendingWrites.empty()) {
+            pendingWrite = std::move(m_PendingWrites.front());
+            m_PendingWrites.pop_front();
+        }
+        else {
+            m_StagedConnection.swap(connection);
+        }
     }
+
+    if (pendingWrite) {
+        pendingWrite->finish();
+        return;
+    }
+
     m_StagedConnectionCV.notify_all();
 
-    bool keepAlive = false;
-    do {
+    Ref<RequestCompletion> completion;
+    try {
+        // The connection already closed itself if the request could not be received.
+        completion = Ref<RequestCompletion>(new RequestCompletion(std::move(*connection)));
+    } catch (const std::exception& ex) {
+        // TODO: Proper Logging
+        std::cout << ex.what() << std::endl;
+        return;
+    } catch (...) {
+        // TODO: Proper Logging
+        std::cout << "Unrecognized Exception" << std::endl;
+        return;
+    }
+
+    if (context) {
+        dispatch(std::move(completion), *context);
+        return;
+    }
+
+    enqueue(std::move(completion));
+}
+
+void DefaultExecutor::enqueue(Ref<RequestCompletion> completion) {
+    u32 laneIndex = 0;
+    if (m_ClassifyRequest) {
+        try {
+            laneIndex = m_ClassifyRequest(completion->getRequest());
+        } catch (...) {}
+
+        if (laneIndex >= m_Lanes.size()) {
+            laneIndex = 0;
+        }
+    }
+
+    Lane& lane = m_Lanes[laneIndex];
+    {
+        std::lock_guard lk(m_PendingRequestsMutex);
+
+        const u32 maxQueuedRequests = lane.settings.maxQueuedRequests;
+        if (maxQueuedRequests == 0 || lane.pendingRequests.size() < maxQueuedRequests) {
+            completion->m_ExecutorLink = m_CompletionLink;
+            completion->m_Response.setDeferSend(true);
+            lane.pendingRequests.push_back(std::move(completion));
+        }
+    }
+
+    if (completion) {
+        // The lane is full, the request is rejected directly on the I/O thread.
+        completion->getResponse().setStatusCode(StatusCode::SERVICE_UNAVAILABLE);
+        completion->complete();
+        return;
+    }
+
+    lane.reservedCV.notify_one();
+    m_PendingRequestsCV.notify_one();
+}
+
+bool DefaultExecutor::hasPendingRequests(u32 lane) const {
+    if (lane != SHARED_LANE) {
+        return !m_Lanes[lane].pendingRequests.empty();
+    }
+
+    return std::ranges::any_of(m_Lanes, [](const Lane& l) {
+        return !l.pendingRequests.empty();
+    });
+}
+
+void DefaultExecutor::processRequests(std::stop_token threadStopToken, std::stop_token executorStopToken,
+    DefaultExecutor* executor, u32 lane, URef<WorkerContext> context) {
+    while (!(threadStopToken.stop_requested() || executorStopToken.stop_requested())) {
+        executor->processRequestsImpl(lane, *context);
+    }
+}
+
+void DefaultExecutor::processRequestsImpl(u32 laneIndex, WorkerContext& context) {
+    Ref<RequestCompletion> completion;
+    {
+        std::unique_lock lk(m_PendingRequestsMutex);
+        auto& cv = laneIndex == SHARED_LANE ? m_PendingRequestsCV : m_Lanes[laneIndex].reservedCV;
+        cv.wait(lk, [this, laneIndex] {
+            return hasPendingRequests(laneIndex) || m_StopSource.stop_requested();
+        });
+
+        if (m_StopSource.stop_requested()) {
+            lk.unlock();
+            rejectPendingRequests();
+            return;
+        }
+
+        if (laneIndex == SHARED_LANE) {
+            laneIndex = *std::ranges::find_if(m_LaneOrder, [this](u32 i) {
+                return !m_Lanes[i].pendingRequests.empty();
+            });
+        }
+
+        auto& pendingRequests = m_Lanes[laneIndex].pendingRequests;
+        completion = std::move(pendingRequests.front());
+        pendingRequests.pop_front();
+    }
+
+    dispatch(std::move(completion), context);
+}
+
+URef<WorkerContext> DefaultExecutor::makeWorkerContext() {
+    URef<WorkerContext> context;
+
+    if (m_CreateWorkerContext) {
+        context = m_CreateWorkerContext();
+    }
+
+    if (!context) {
+        context = std::make_unique<WorkerContext>();
+    }
+
+    return context;
+}
+
+void DefaultExecutor::dispatch(Ref<RequestCompletion> completion, WorkerContext& context) {
+    if (completion->getRequest().isExpired()) {
+        // The response could not be delivered in time, the handler is not worth running.
+        completion->getResponse().setStatusCode(StatusCode::SERVICE_UNAVAILABLE);
+        completion->complete();
+        return;
+    }
+
+    if (m_AsyncProcessRequest) {
         try {
-            HttpRequest request = connection->getNextRequest();
-            HttpResponse response = connection->makeResponse();
-
-            response.setVersion(request.getVersion());
-
-            if (m_ProcessRequest) {
-                try {
-                    if (m_ProcessRequest(request, response)) {
-                        // Success
-
-                        if (!response.wasSent()) {
-                            response.send();
-                        }
-                        continue;
-                    }
-                } catch (...) {}
-
-                // Failure
-                response.setStatusCode(StatusCode::INTERNAL_SERVER_ERROR);
-                response.clearHeaderFields();
-                response.generateDefaultReasonPhrase();
-                keepAlive = false;
-            }
-            else {
-                response.setStatusCode(StatusCode::INTERNAL_SERVER_ERROR);
-                keepAlive = false;
-            }
-
-            response.send();
-        } catch (const std::exception& ex) {
-            // TODO: Proper Logging
-            std::cout << ex.what() << std::endl;
-            keepAlive = false;
+            m_AsyncProcessRequest(completion, context);
         } catch (...) {
-            // TODO: Proper Logging
-            std::cout << "Unrecognized Exception" << std::endl;
-            keepAlive = false;
+            completion->complete(false);
+        }
+        return;
+    }
+
+    bool success = false;
+    if (m_ProcessRequest) {
+        try {
+            success = m_ProcessRequest(completion->getRequest(), completion->getResponse(), context);
+        } catch (...) {}
+    }
+
+    completion->complete(success);
+}
+
+bool DefaultExecutor::scheduleWrite(Ref<RequestCompletion> completion) {
+    {
+        std::lock_guard lk(m_StagedConnectionMutex);
+
+        if (m_StopSource.stop_requested()) {
+            // No I/O thread is left to write the response.
+            return false;
+        }
+
+        m_PendingWrites.push_back(std::move(completion));
+    }
+
+    m_StagedConnectionCV.notify_all();
+    return true;
+}
+
+void DefaultExecutor::finishPendingWrites() {
+    std::deque<Ref<RequestCompletion>> pendingWrites;
+    {
+        std::lock_guard lk(m_StagedConnectionMutex);
+        pendingWrites.swap(m_PendingWrites);
+    }
+
+    // Once stopped, no write is queued anymore, so the responses left are written here.
+    for (const auto& completion : pendingWrites) {
+        completion->finish();
+    }
+}
+
+void DefaultExecutor::rejectPendingRequests() {
+    std::vector<Ref<RequestCompletion>> pendingRequests;
+    {
+        std::lock_guard lk(m_PendingRequestsMutex);
+
+        for (auto& lane : m_Lanes) {
+            std::ranges::move(lane.pendingRequests, std::back_inserter(pendingRequests));
+            lane.pendingRequests.clear();
         }
-    } while (keepAlive);
+    }
 
-    connection->close();
+    // Being stopped, the executor writes the rejections at once instead of queuing them.
+    for (const auto& completion : pendingRequests) {
+        completion->getResponse().setStatusCode(StatusCode::SERVICE_UNAVAILABLE);
+        completion->complete();
+    }
 }
 
 DefaultExecutor::~DefaultExecutor() {
+    {
+        // Completions held by asynchronous handlers write their response themselves from now on.
+        std::unique_lock lk(m_CompletionLink->mutex);
+        m_CompletionLink->executor = nullptr;
+    }
+
     stop();
+
+    // The threads must be joined before the queues they use are destroyed.
+    m_ComputeThreads.clear();
+    m_Threads.clear();
+
+    // Requests queued or completed while no thread was left to take them.
+    rejectPendingRequests();
+    finishPendingWrites();
 }
 
 } // namespace simpleHTTP
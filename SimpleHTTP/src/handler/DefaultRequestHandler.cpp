@@ -3,55 +3,318 @@
 #include <iostream>
 #include <array>
 #include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
 
 namespace simpleHTTP {
 
-RequestProcessor::RequestProcessor(InitializerList processors)
-    : m_ProcessFunctions(processors.begin(), processors.end()) {}
+Bulkhead::Bulkhead(u32 maxConcurrentRequests, u32 maxQueuedRequests)
+    : m_MaxConcurrentRequests(maxConcurrentRequests), m_MaxQueuedRequests(maxQueuedRequests) {}
 
-std::string RequestProcessor::getMethodsList() const {
-    auto it = m_ProcessFunctions.begin();
-    auto end = m_ProcessFunctions.end();
+bool Bulkhead::enter(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock lk(m_Mutex);
+
+    if (m_ActiveRequests < m_MaxConcurrentRequests) {
+        ++m_ActiveRequests;
+        return true;
+    }
+
+    if (m_QueuedRequests >= m_MaxQueuedRequests) {
+        return false;
+    }
+
+    const auto hasSlot = [this] {
+        return m_ActiveRequests < m_MaxConcurrentRequests;
+    };
+
+    ++m_QueuedRequests;
+
+    bool acquired = true;
+    if (deadline == std::chrono::steady_clock::time_point::max()) {
+        m_CV.wait(lk, hasSlot);
+    }
+    else {
+        acquired = m_CV.wait_until(lk, deadline, hasSlot);
+    }
+
+    --m_QueuedRequests;
+
+    if (!acquired) {
+        return false;
+    }
 
-    if (it == end)
-        return std::string();
+    ++m_ActiveRequests;
+    return true;
+}
+
+void Bulkhead::leave() {
+    {
+        std::lock_guard lk(m_Mutex);
+        --m_ActiveRequests;
+    }
+    m_CV.notify_one();
+}
+
+static constexpr u64 MAX_HOST_LENGTH = 255;
+
+static void toLower(std::string_view text, char* out) {
+    std::ranges::transform(text, out, [](char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    });
+}
+
+/// @brief Lowercases the host into the buffer, without its port or trailing dot.
+/// @return an empty view if the host does not fit in the buffer.
+static std::string_view normalizeHost(std::string_view host, std::array<char, MAX_HOST_LENGTH>& buffer) {
+    if (host.starts_with('[')) {
+        // IPv6 literal, whose colons are not a port separator.
+        host = host.substr(0, host.find(']') + 1);
+    }
+    else if (auto colon = host.rfind(':'); colon != std::string_view::npos) {
+        host = host.substr(0, colon);
+    }
+
+    if (host.ends_with('.')) {
+        host.remove_suffix(1);
+    }
+
+    if (host.size() > buffer.size()) {
+        return std::string_view();
+    }
+
+    toLower(host, buffer.data());
+    return std::string_view(buffer.data(), host.size());
+}
+
+static constexpr u64 MAX_EXTENSION_LENGTH = 16;
+static constexpr std::string_view NO_CACHE_HEADER_BLOCK = "Cache-Control: no-cache\r\n";
+
+/// @brief Returns the extension of the last segment of the path, without its dot.
+static std::string_view getExtension(std::string_view path) {
+    const auto slash = path.find_last_of('/');
+    const std::string_view name = slash == std::string_view::npos ? path : path.substr(slash + 1);
+    const auto dot = name.find_last_of('.');
+
+    if (dot == std::string_view::npos || dot == 0) {
+        return std::string_view();
+    }
+
+    return name.substr(dot + 1);
+}
+
+static std::string serializeCachePolicy(const CachePolicy& policy) {
+    if (policy.noStore) {
+        return "Cache-Control: no-store\r\n";
+    }
 
-    std::string result = httpMethodToString(it->first);
+    std::string block = "Cache-Control: ";
 
-    ++it;
-    for (; it != end; ++it) {
-        result.append(", ");
-        result.append(httpMethodToString(it->first));
+    if (policy.isPrivate) {
+        block.append("private, ");
+    }
+
+    if (policy.maxAge.count() >= 0) {
+        block.append("max-age=" + std::to_string(policy.maxAge.count()));
+    }
+    else {
+        block.append("no-cache");
+    }
+
+    if (policy.sharedMaxAge.count() >= 0 && !policy.isPrivate) {
+        block.append(", s-maxage=" + std::to_string(policy.sharedMaxAge.count()));
+    }
+
+    if (policy.immutable) {
+        block.append(", immutable");
+    }
+
+    block.append("\r\n");
+    return block;
+}
+
+static URef<Bulkhead> makeBulkhead(const RouteSettings& settings) {
+    if (settings.maxConcurrentRequests == 0) {
+        return nullptr;
+    }
+
+    return std::make_unique<Bulkhead>(settings.maxConcurrentRequests, settings.maxQueuedRequests);
+}
+
+/// @brief Slot taken in the bulkhead of a route, left when the slot is destroyed.
+class BulkheadSlot
+{
+public:
+    explicit BulkheadSlot(const RequestProcessor* processor)
+        : m_Processor(processor) {}
+
+    BulkheadSlot(const BulkheadSlot&) = delete;
+    BulkheadSlot(BulkheadSlot&& other) noexcept
+        : m_Processor(std::exchange(other.m_Processor, nullptr)) {}
+
+    BulkheadSlot& operator=(const BulkheadSlot&) = delete;
+    BulkheadSlot& operator=(BulkheadSlot&&) = delete;
+
+    ~BulkheadSlot() {
+        if (m_Processor) {
+            m_Processor->leave();
+        }
+    }
+private:
+    const RequestProcessor* m_Processor;
+};
+
+RequestProcessor::RequestProcessor(InitializerList processors, RouteSettings settings)
+    : m_Settings(std::move(settings)),
+    m_Bulkhead(makeBulkhead(m_Settings)) {
+    for (const auto& [method, processFunction] : processors) {
+        m_ProcessFunctions[static_cast<u64>(method)] = processFunction;
+    }
+
+    m_HeaderBlock = "Allow: " + getMethodsList() + "\r\n"
+        "X-Content-Type-Options: nosniff\r\n";
+}
+
+RequestProcessor::RequestProcessor(const RequestProcessor& other)
+    : m_ProcessFunctions(other.m_ProcessFunctions),
+    m_HeaderBlock(other.m_HeaderBlock),
+    m_Settings(other.m_Settings),
+    m_Bulkhead(makeBulkhead(m_Settings)) {}
+
+std::string RequestProcessor::getMethodsList() const {
+    std::string result;
+
+    for (u64 i = 0; i < HTTP_METHOD_COUNT; ++i) {
+        if (!m_ProcessFunctions[i]) {
+            continue;
+        }
+
+        if (!result.empty()) {
+            result.append(", ");
+        }
+        result.append(httpMethodToString(static_cast<HttpMethod>(i)));
     }
 
     return result;
 }
 
-std::unique_ptr<Resource> RequestProcessor::operator()(const HttpRequest& request) const {
-    HttpMethod method = request.getMethod();
+const std::string& RequestProcessor::getHeaderBlock() const {
+    return m_HeaderBlock;
+}
 
-    auto it = m_ProcessFunctions.find(method);
+const RouteSettings& RequestProcessor::getSettings() const {
+    return m_Settings;
+}
+
+bool RequestProcessor::enter(const HttpRequest& request) const {
+    if (!m_Bulkhead) {
+        return true;
+    }
+
+    auto deadline = request.getDeadline();
+    if (m_Settings.queueTimeout.count() > 0) {
+        deadline = std::min(deadline, std::chrono::steady_clock::now() + m_Settings.queueTimeout);
+    }
+
+    return m_Bulkhead->enter(deadline);
+}
 
-    if (it != m_ProcessFunctions.end()) {
-        return it->second(request);
+void RequestProcessor::leave() const {
+    if (m_Bulkhead) {
+        m_Bulkhead->leave();
+    }
+}
+
+std::unique_ptr<Resource> RequestProcessor::operator()(const HttpRequest& request) const {
+    const auto& processFunction = m_ProcessFunctions[static_cast<u64>(request.getMethod())];
+
+    if (processFunction) {
+        return processFunction(request);
     }
 
     return std::make_unique<Resource>();
 }
 
 void DefaultRequestHandlerSettings::registerRequestProcessor(std::string_view uri,
-    RequestProcessor::InitializerList processors) {
-    m_RequestProcessors.emplace(uri, processors);
+    RequestProcessor::InitializerList processors, RouteSettings routeSettings) {
+    registerRequestProcessor(std::string_view(), uri, processors, std::move(routeSettings));
+}
+
+void DefaultRequestHandlerSettings::registerRequestProcessor(std::string_view host, std::string_view uri,
+    RequestProcessor::InitializerList processors, RouteSettings routeSettings) {
+    m_RequestProcessors.push_back(Route{ std::string(host), std::string(uri),
+        RequestProcessor(processors, std::move(routeSettings)) });
+}
+
+void DefaultRequestHandlerSettings::setExtensionCachePolicy(std::string_view extension, CachePolicy policy) {
+    if (extension.starts_with('.')) {
+        extension.remove_prefix(1);
+    }
+
+    std::string key(extension.size(), '\0');
+    toLower(extension, key.data());
+
+    m_ExtensionCachePolicies.emplace_back(std::move(key), policy);
+}
+
+void DefaultRequestHandlerSettings::addMiddleware(MiddlewarePipeline::Middleware middleware) {
+    m_Middlewares.add(std::move(middleware));
 }
 
 DefaultRequestHandler::DefaultRequestHandler(const DefaultRequestHandlerSettings& settings)
-    : m_HttpVersion(settings.httpVersion), m_RequestProcessors(settings.m_RequestProcessors) {}
+    : m_HttpVersion(settings.httpVersion),
+    m_Middlewares(settings.m_Middlewares) {
+    const auto makeCacheHeaders = [](const CachePolicy& policy) {
+        return CacheHeaders{ serializeCachePolicy(policy), policy.expires && !policy.noStore,
+            std::max(policy.maxAge, std::chrono::seconds(0)) };
+    };
+
+    m_CacheHeaders = makeCacheHeaders(settings.cachePolicy);
+
+    for (const auto& [extension, policy] : settings.m_ExtensionCachePolicies) {
+        if (extension.size() <= MAX_EXTENSION_LENGTH) {
+            m_ExtensionCacheHeaders.insert_or_assign(extension, makeCacheHeaders(policy));
+        }
+    }
 
-bool DefaultRequestHandler::processRequest(const HttpRequest& request, HttpResponse& response) const {
-    if (m_RequestFilter && !m_RequestFilter(request)) {
-        return false;
+    m_RequestProcessors.reserve(settings.m_RequestProcessors.size());
+    m_RouteCacheHeaders.reserve(settings.m_RequestProcessors.size());
+
+    // The routes are only matched through the tries, which are built once here.
+    for (const auto& [host, uri, processor] : settings.m_RequestProcessors) {
+        Router* router = &m_Router;
+
+        if (!host.empty()) {
+            std::array<char, MAX_HOST_LENGTH> buffer;
+            std::string_view normalizedHost = normalizeHost(host, buffer);
+
+            if (normalizedHost.empty()) {
+                throw std::runtime_error("Invalid virtual host.");
+            }
+
+            if (normalizedHost.starts_with("*.")) {
+                router = &m_WildcardHostRouters[std::string(normalizedHost.substr(2))];
+            }
+            else {
+                router = &m_HostRouters[std::string(normalizedHost)];
+            }
+        }
+
+        router->insert(URI(uri).getSegmentsSection(), static_cast<u32>(m_RequestProcessors.size()));
+        m_RequestProcessors.push_back(processor);
+
+        const auto& cachePolicy = processor.getSettings().cachePolicy;
+        m_RouteCacheHeaders.push_back(cachePolicy ? std::optional(makeCacheHeaders(*cachePolicy)) : std::nullopt);
     }
+}
 
+bool DefaultRequestHandler::processRequest(const HttpRequest& request, HttpResponse& response) const {
+    return m_Middlewares.run(request, response, [this](const HttpRequest& request, HttpResponse& response) {
+        return dispatchRequest(request, response);
+    });
+}
+
+bool DefaultRequestHandler::dispatchRequest(const HttpRequest& request, HttpResponse& response) const {
     response.setVersion(m_HttpVersion);
 
     if (request.getVersion().major > m_HttpVersion.major) {
@@ -59,39 +322,30 @@ bool DefaultRequestHandler::processRequest(const HttpRequest& request, HttpRespo
         return true;
     }
 
-    HttpMethod method = request.getMethod();
-    const URI& uri = request.getURI();
+    const u32 route = matchRoute(request);
 
-    if (m_RequestProcessors.size() == 0) {
+    if (route == Router::NO_MATCH) {
         return false;
     }
 
-    const RequestProcessor* requestProcessor = nullptr;
-    {
-        auto it = m_RequestProcessors.crbegin();
-        for (; it != m_RequestProcessors.crend(); ++it) {
-            if (it->first.isSubURI(uri)) {
-                requestProcessor = &it->second;
-                break;
-            }
-        }
+    const RequestProcessor* requestProcessor = &m_RequestProcessors[route];
 
-        if (it == m_RequestProcessors.crend()) {
-            return false;
-        }
+    if (!requestProcessor->enter(request)) {
+        // The route is saturated, the request is rejected before it can take a thread for long.
+        response.setStatusCode(StatusCode::SERVICE_UNAVAILABLE);
+        return true;
     }
 
-    if (requestProcessor == nullptr) {
-        return false;
-    }
+    // The slot is left once the body is sent, so that slow readers of large bodies also count against the route.
+    BulkheadSlot slot(requestProcessor);
 
-    auto resource = (*requestProcessor)(request);
-    response.setStatusCode(resource->getStatusCode());
+    std::unique_ptr<Resource> resource = (*requestProcessor)(request);
 
-    response.addHeaderField("Allow", requestProcessor->getMethodsList());
+    const StatusCodeType statusCode = resource->getStatusCode();
+    response.setStatusCode(statusCode);
 
-    response.addHeaderField("Cache-Control", "no-cache");
-    response.addHeaderField("X-Content-Type-Options", "nosniff");
+    response.addHeaderBlock(requestProcessor->getHeaderBlock());
+    addCacheHeaders(request, response, statusCode, route);
 
     u64 contentLength = resource->getContentLength();
 
@@ -116,13 +370,115 @@ bool DefaultRequestHandler::processRequest(const HttpRequest& request, HttpRespo
         response.addHeaderField("Content-Type", contentType.toString());
     }
 
-    response.send([&resource](ClientSocket* socket) {
+    // The body may be written after this function returns, when the executor defers sending.
+    response.send([resource = std::move(resource), slot = std::move(slot)](ClientSocket* socket) {
         resource->sendCallback(socket);
     });
 
     return true;
 }
 
+u32 DefaultRequestHandler::classifyRequest(const HttpRequest& request) const {
+    const u32 route = matchRoute(request);
+
+    if (route == Router::NO_MATCH) {
+        return 0;
+    }
+
+    return m_RequestProcessors[route].getSettings().lane;
+}
+
+void DefaultRequestHandler::validateRequest(const HttpRequest& request) const {
+    const u32 route = matchRoute(request);
+
+    if (route == Router::NO_MATCH) {
+        return;
+    }
+
+    const RouteSettings& settings = m_RequestProcessors[route].getSettings();
+
+    if (settings.maxContentLength > 0 && request.getContentLength() > settings.maxContentLength) {
+        throw HttpException(StatusCode::CONTENT_TOO_LARGE, "Content too large for the route.");
+    }
+
+    if (settings.requestValidator) {
+        settings.requestValidator(request);
+    }
+}
+
+void DefaultRequestHandler::addCacheHeaders(const HttpRequest& request, HttpResponse& response,
+    StatusCodeType statusCode, u32 route) const {
+    // An error must not outlive its cause. Other responses keep the policy, so that a 304 (Not Modified)
+    // refreshes a cached response with the fields of the original.
+    if (statusCode >= 400) {
+        response.addHeaderBlock(NO_CACHE_HEADER_BLOCK);
+        return;
+    }
+
+    const CacheHeaders* cacheHeaders = &m_CacheHeaders;
+
+    if (const auto& routeCacheHeaders = m_RouteCacheHeaders[route]) {
+        cacheHeaders = &*routeCacheHeaders;
+    }
+    else if (!m_ExtensionCacheHeaders.empty()) {
+        const std::string_view extension = getExtension(request.getURI().getSegmentsSection());
+
+        if (!extension.empty() && extension.size() <= MAX_EXTENSION_LENGTH) {
+            std::array<char, MAX_EXTENSION_LENGTH> buffer;
+            toLower(extension, buffer.data());
+
+            auto it = m_ExtensionCacheHeaders.find(std::string_view(buffer.data(), extension.size()));
+            if (it != m_ExtensionCacheHeaders.end()) {
+                cacheHeaders = &it->second;
+            }
+        }
+    }
+
+    response.addHeaderBlock(cacheHeaders->headerBlock);
+
+    if (cacheHeaders->expires) {
+        response.addHeaderField("Expires", formatHttpDate(std::chrono::system_clock::now() + cacheHeaders->maxAge));
+    }
+}
+
+const Router& DefaultRequestHandler::selectRouter(std::string_view host) const {
+    if (m_HostRouters.empty() && m_WildcardHostRouters.empty()) {
+        return m_Router;
+    }
+
+    std::array<char, MAX_HOST_LENGTH> buffer;
+    host = normalizeHost(host, buffer);
+
+    if (auto it = m_HostRouters.find(host); it != m_HostRouters.end()) {
+        return it->second;
+    }
+
+    if (!m_WildcardHostRouters.empty()) {
+        // Each parent domain from the longest, so the most specific wildcard wins.
+        for (auto dot = host.find('.'); dot != std::string_view::npos; dot = host.find('.', dot + 1)) {
+            if (auto it = m_WildcardHostRouters.find(host.substr(dot + 1)); it != m_WildcardHostRouters.end()) {
+                return it->second;
+            }
+        }
+    }
+
+    return m_Router;
+}
+
+u32 DefaultRequestHandler::findRoute(const HttpRequest& request, PathParameters* parameters) const {
+    const Router& router = selectRouter(request.getHost());
+    return router.match(request.getURI().getSegmentsSection(), parameters);
+}
+
+u32 DefaultRequestHandler::matchRoute(const HttpRequest& request) const {
+    if (request.m_RouteHandler != this) {
+        request.m_Route = findRoute(request, &request.m_PathParameters);
+        request.m_RouteHandler = this;
+    }
+
+    return request.m_Route;
+}
+
 DefaultRequestHandler::~DefaultRequestHandler() {}
 
 } // namespace simpleHTTP
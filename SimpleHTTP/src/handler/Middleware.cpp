@@ -0,0 +1,28 @@
+#include <SimpleHTTP/handler/Middleware.h>
+
+namespace simpleHTTP {
+
+MiddlewareNext::MiddlewareNext(const Invocation& invocation, std::size_t index)
+    : m_Invocation(invocation), m_Index(index) {}
+
+bool MiddlewareNext::operator()() const {
+    return m_Invocation.pipeline.run(m_Invocation, m_Index);
+}
+
+void MiddlewarePipeline::add(Middleware middleware) {
+    m_Middlewares.push_back(std::move(middleware));
+}
+
+bool MiddlewarePipeline::empty() const {
+    return m_Middlewares.empty();
+}
+
+bool MiddlewarePipeline::run(const MiddlewareNext::Invocation& invocation, std::size_t index) const {
+    if (index == m_Middlewares.size()) {
+        return invocation.invokeHandler(invocation.handler, invocation.request, invocation.response);
+    }
+
+    return m_Middlewares[index](invocation.request, invocation.response, MiddlewareNext(invocation, index + 1));
+}
+
+} // namespace simpleHTTP
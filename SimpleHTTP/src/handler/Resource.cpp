@@ -101,10 +101,10 @@ void FileResource::sendCallback(ClientSocket* socket) {
         return;
     }
 
-    std::vector<char> buffer(FILE_INPUT_BUFFER_SIZE, 0);
+    Buffer buffer = BufferPool::acquire(FILE_INPUT_BUFFER_SIZE);
 
     while (!file.eof()) {
-        file.read(buffer.data(), buffer.size());
+        file.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
         std::streamsize size = file.gcount();
 
         if (size == 0)
@@ -0,0 +1,204 @@
+#include <SimpleHTTP/handler/Router.h>
+
+#include <stdexcept>
+
+namespace simpleHTTP {
+
+/// @brief Extracts the next non-empty segment of the path.
+/// @return false if the path has no segment left.
+static bool nextSegment(std::string_view& path, std::string_view& segment) {
+    const auto begin = path.find_first_not_of('/');
+    if (begin == std::string_view::npos) {
+        path = std::string_view();
+        return false;
+    }
+
+    const auto end = path.find('/', begin);
+    segment = path.substr(begin, end - begin);
+    path = end == std::string_view::npos ? std::string_view() : path.substr(end);
+    return true;
+}
+
+static std::string_view trimLeadingSlashes(std::string_view path) {
+    const auto begin = path.find_first_not_of('/');
+    return begin == std::string_view::npos ? std::string_view() : path.substr(begin);
+}
+
+static bool isParameter(std::string_view segment) {
+    return segment.size() > 2 && segment.front() == '{' && segment.back() == '}';
+}
+
+static bool isWildcard(std::string_view segment) {
+    return segment == "*";
+}
+
+Router::Router()
+    : m_Nodes(1) {}
+
+void Router::insert(std::string_view path, u32 value) {
+    std::vector<std::string> segments;
+    u64 captures = 0;
+    for (std::string_view segment; nextSegment(path, segment);) {
+        if (isParameter(segment) || isWildcard(segment)) {
+            ++captures;
+        }
+        segments.emplace_back(segment);
+    }
+
+    if (captures > PathParameters::CAPACITY) {
+        throw std::runtime_error("Too many parameters in the route.");
+    }
+
+    u32 node = 0;
+    u64 i = 0;
+    while (i < segments.size()) {
+        const std::string& segment = segments[i];
+
+        if (isWildcard(segment)) {
+            if (i + 1 != segments.size()) {
+                throw std::runtime_error("A wildcard must be the last segment of a route.");
+            }
+
+            m_Nodes[node].wildcardValue = value;
+            return;
+        }
+
+        if (isParameter(segment)) {
+            const std::string_view name = std::string_view(segment).substr(1, segment.size() - 2);
+
+            if (m_Nodes[node].parameter == NO_NODE) {
+                Node parameter;
+                parameter.parameterName = name;
+
+                m_Nodes[node].parameter = static_cast<u32>(m_Nodes.size());
+                m_Nodes.push_back(std::move(parameter));
+            }
+            else if (m_Nodes[m_Nodes[node].parameter].parameterName != name) {
+                throw std::runtime_error("Conflicting parameter names in the routes.");
+            }
+
+            node = m_Nodes[node].parameter;
+            ++i;
+            continue;
+        }
+
+        // The literal segments up to the next parameter or wildcard.
+        u64 literalEnd = i + 1;
+        while (literalEnd < segments.size() && !isParameter(segments[literalEnd]) && !isWildcard(segments[literalEnd])) {
+            ++literalEnd;
+        }
+
+        auto it = m_Nodes[node].children.find(segment);
+
+        if (it == m_Nodes[node].children.end()) {
+            Node leaf;
+            leaf.label.assign(segments.begin() + i, segments.begin() + literalEnd);
+
+            const u32 leafIndex = static_cast<u32>(m_Nodes.size());
+            m_Nodes[node].children.emplace(segment, leafIndex);
+            m_Nodes.push_back(std::move(leaf));
+
+            node = leafIndex;
+            i = literalEnd;
+            continue;
+        }
+
+        const u32 child = it->second;
+        auto& label = m_Nodes[child].label;
+
+        u64 common = 1;
+        while (common < label.size() && i + common < literalEnd && label[common] == segments[i + common]) {
+            ++common;
+        }
+
+        if (common < label.size()) {
+            // The path diverges inside the edge, which is split at the divergence.
+            Node prefix;
+            prefix.label.assign(label.begin(), label.begin() + common);
+            label.erase(label.begin(), label.begin() + common);
+            prefix.children.emplace(label.front(), child);
+
+            const u32 prefixIndex = static_cast<u32>(m_Nodes.size());
+            it->second = prefixIndex;
+            m_Nodes.push_back(std::move(prefix));
+
+            node = prefixIndex;
+        }
+        else {
+            node = child;
+        }
+
+        i += common;
+    }
+
+    m_Nodes[node].value = value;
+}
+
+u32 Router::match(std::string_view path, PathParameters* parameters) const {
+    Match best;
+    match(0, path, PathParameters(), best);
+
+    if (parameters && best.value != NO_MATCH) {
+        *parameters = best.parameters;
+    }
+
+    return best.value;
+}
+
+bool Router::match(u32 index, std::string_view path, const PathParameters& captures, Match& best) const {
+    const Node& node = m_Nodes[index];
+    path = trimLeadingSlashes(path);
+
+    const auto isBetter = [&best](u64 remaining) {
+        return best.value == NO_MATCH || remaining < best.remaining;
+    };
+
+    if (node.value != NO_MATCH && isBetter(path.size())) {
+        best = { node.value, path.size(), captures };
+
+        if (path.empty()) {
+            return true;
+        }
+    }
+
+    std::string_view rest = path;
+    std::string_view segment;
+    if (nextSegment(rest, segment)) {
+        auto it = node.children.find(segment);
+        if (it != node.children.end()) {
+            const Node& child = m_Nodes[it->second];
+
+            bool matches = true;
+            std::string_view childRest = rest;
+            for (u64 i = 1; i < child.label.size() && matches; ++i) {
+                // Only nodes hold values, a partially matched edge is not a prefix.
+                std::string_view childSegment;
+                matches = nextSegment(childRest, childSegment) && childSegment == child.label[i];
+            }
+
+            if (matches && match(it->second, childRest, captures, best)) {
+                return true;
+            }
+        }
+
+        if (node.parameter != NO_NODE) {
+            // The number of parameters of a route is checked on insertion, so the capture always fits.
+            PathParameters parameterCaptures = captures;
+            parameterCaptures.add(m_Nodes[node.parameter].parameterName, segment);
+
+            if (match(node.parameter, rest, parameterCaptures, best)) {
+                return true;
+            }
+        }
+    }
+
+    if (node.wildcardValue != NO_MATCH && isBetter(0)) {
+        best = { node.wildcardValue, 0, captures };
+        best.parameters.add("*", path);
+        return true;
+    }
+
+    return false;
+}
+
+} // namespace simpleHTTP
@@ -0,0 +1,21 @@
+#pragma once
+#include <SimpleHTTP/types.h>
+
+namespace simpleHTTP {
+
+/// @brief Whether the character is a hexadecimal digit, in either case.
+constexpr bool isHex(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f');
+}
+
+/// @brief Returns the value of a hexadecimal digit.
+/// @note The character must be one, as checked by isHex.
+constexpr u8 hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return static_cast<u8>(c - '0');
+    }
+
+    return static_cast<u8>((c | 0x20) - 'a' + 10);
+}
+
+} // namespace simpleHTTP
@@ -11,13 +11,16 @@
 namespace simpleHTTP {
 
 static constexpr const u64 MAX_METHOD_LENGTH = 0xff;
-static constexpr const u64 MAX_ELEMENT_LENGTH = 0x2000;
 static constexpr const u64 MAX_VERSION_LENGTH = 0xff;
+// One day, in milliseconds.
+static constexpr const u64 MAX_REQUEST_DEADLINE_FIELD = 86400000;
 
 static constexpr const std::array<i8, 2> CRLF = { 13, 10 };
 static constexpr const i8 SP = 32;
 static constexpr const i8 HTAB = 9;
 
+static constexpr const std::string_view CONTINUE_RESPONSE = "HTTP/1.1 100 Continue\r\n\r\n";
+
 const HttpVersion HttpVersion::UNKNOWN{ 0,0 };
 const HttpVersion HttpVersion::V0_9{ 0,9 };
 const HttpVersion HttpVersion::V1_0{ 1,0 };
@@ -25,6 +28,13 @@ const HttpVersion HttpVersion::V1_1{ 1,1 };
 const HttpVersion HttpVersion::V2_0{ 2,0 };
 const HttpVersion HttpVersion::V3_0{ 3,0 };
 
+HttpException::HttpException(StatusCode code, const std::string& message)
+    : std::runtime_error(message), m_StatusCode(code) {}
+
+StatusCode HttpException::getStatusCode() const {
+    return m_StatusCode;
+}
+
 bool HttpVersion::operator==(const HttpVersion& other) const noexcept {
     return other.major == major && other.minor == minor;
 }
@@ -99,17 +109,88 @@ static constexpr HttpVersion getVersionFromString(std::string_view str) {
     return result;
 }
 
-HttpServerConnection::HttpServerConnection(ClientSocket&& socket)
-    : m_Socket(socket) {}
+HttpServerConnection::HttpServerConnection(ClientSocket&& socket, const HttpServerSettings* settings, MemoryBudget* budget)
+    : m_Socket(std::move(socket)), m_Settings(settings), m_MemoryBudget(budget) {}
 
 HttpServerConnection::~HttpServerConnection() {}
 
 HttpRequest HttpServerConnection::getNextRequest() {
-    return HttpRequest(&m_Socket);
+    try {
+        m_Socket.releaseCache();
+
+        m_Socket.startTimeout(m_Settings->idleTimeout);
+        if (!m_Socket.waitForData()) {
+            m_Socket.stopTimeout();
+            throw std::runtime_error("Connection closed before receiving a request.");
+        }
+
+        m_Socket.startTimeout(m_Settings->headerTimeout);
+        HttpRequest request(&m_Socket, *m_Settings, m_MemoryBudget);
+
+        if (m_Settings->requestValidator) {
+            m_Settings->requestValidator(request);
+        }
+
+        m_Socket.startTimeout(m_Settings->contentTimeout);
+
+        if (request.expectsContinue()) {
+            m_Socket.send(CONTINUE_RESPONSE.data(), CONTINUE_RESPONSE.size());
+        }
+
+        request.receiveContent();
+
+        m_Socket.stopTimeout();
+        // The buffer is not needed while the request is processed.
+        m_Socket.releaseCache();
+        return request;
+    } catch (const HttpException& ex) {
+        reject(ex.getStatusCode());
+        throw;
+    } catch (...) {
+        close();
+        throw;
+    }
 }
 
 HttpResponse HttpServerConnection::makeResponse() {
-    return HttpResponse(&m_Socket);
+    return HttpResponse(&m_Socket, m_Settings->sendTimeout, m_MemoryBudget);
+}
+
+static std::string makeRejection(StatusCode code) {
+    const char* reason = getDefaultReasonPhrase(code);
+
+    return std::format("{} {} {}\r\nConnection: close\r\nContent-Length: 0\r\n\r\n",
+        HttpVersion::V1_1, static_cast<StatusCodeType>(code), reason ? reason : "");
+}
+
+void HttpServerConnection::reject(StatusCode code) {
+    static const std::unordered_map<StatusCode, std::string> rejections = [] {
+        std::unordered_map<StatusCode, std::string> result;
+
+        for (StatusCode c : { StatusCode::BAD_REQUEST, StatusCode::UNAUTHORIZED, StatusCode::CONTENT_TOO_LARGE,
+            StatusCode::URI_TOO_LONG, StatusCode::EXPECTATION_FAILED, StatusCode::REQUEST_HEADER_FIELDS_TOO_LARGE,
+            StatusCode::NOT_IMPLEMENTED,
+            StatusCode::SERVICE_UNAVAILABLE, StatusCode::HTTP_VERSION_NOT_SUPPORTED }) {
+            result.emplace(c, makeRejection(c));
+        }
+
+        return result;
+    }();
+
+    try {
+        m_Socket.startTimeout(m_Settings->sendTimeout, true);
+
+        auto it = rejections.find(code);
+        if (it != rejections.end()) {
+            m_Socket.send(it->second.data(), it->second.size());
+        }
+        else {
+            const std::string rejection = makeRejection(code);
+            m_Socket.send(rejection.data(), rejection.size());
+        }
+    } catch (...) {}
+
+    close();
 }
 
 void HttpServerConnection::close() {
@@ -117,71 +198,144 @@ void HttpServerConnection::close() {
 }
 
 HttpServer::HttpServer(HttpServerSettings config)
-    : m_Settings(std::move(config)), m_Socket(8001) {}
+    : m_Settings(std::move(config)), m_Socket(8001), m_MemoryBudget(m_Settings.memoryBudget) {
+    const bool hasTimeouts = m_Settings.idleTimeout.count() > 0 || m_Settings.headerTimeout.count() > 0 ||
+        m_Settings.contentTimeout.count() > 0 || m_Settings.sendTimeout.count() > 0;
+
+    if (!hasTimeouts || m_Settings.timeoutResolution.count() <= 0) {
+        return;
+    }
+
+    m_TimerWheel = makeRef<TimerWheel>(m_Settings.timeoutResolution);
+    m_TimerThread = std::jthread([wheel = m_TimerWheel.get()](std::stop_token st) {
+        while (!st.stop_requested()) {
+            std::this_thread::sleep_for(wheel->getResolution());
+            wheel->advance();
+        }
+    });
+}
 
 HttpServerConnection HttpServer::accept() {
-    return { std::move(m_Socket.accept()) };
+    ClientSocket socket = m_Socket.accept();
+
+    if (m_TimerWheel) {
+        socket.setTimerWheel(m_TimerWheel);
+    }
+
+    return { std::move(socket), &m_Settings, &m_MemoryBudget };
 }
 
 u16 HttpServer::getPort() const {
     return m_Socket.getPort();
 }
 
+const MemoryBudget& HttpServer::getMemoryBudget() const {
+    return m_MemoryBudget;
+}
+
 void HttpServer::stop() {
     m_Socket.close();
 }
 
 HttpServer::~HttpServer() {
-
+    if (m_TimerThread.joinable()) {
+        m_TimerThread.request_stop();
+        m_TimerThread.join();
+    }
 }
 
-HttpRequest::HttpRequest(ClientSocket* socket)
-    : m_Socket(socket) {
-    // TODO: use custom allocator?
-    std::vector<i8> buffer{};
-    buffer.resize(MAX_METHOD_LENGTH + MAX_ELEMENT_LENGTH + MAX_VERSION_LENGTH + 2);
+HttpRequest::HttpRequest(ClientSocket* socket, const HttpServerSettings& settings, MemoryBudget* memoryBudget)
+    : m_Socket(socket), m_Reservation(memoryBudget) {
+    const u64 maxRequestLineLength = MAX_METHOD_LENGTH + settings.maxUriLength + MAX_VERSION_LENGTH + 2;
 
-    u64 requestLineLength = m_Socket->receiveUntil(buffer.data(), buffer.size(), CRLF.data(), CRLF.size());
+    // One more byte than the limits, so that a line over them is detected instead of truncated.
+    Buffer block = BufferPool::acquire(std::max(maxRequestLineLength, settings.maxHeaderFieldLength) + 1);
+    std::span<i8> buffer(reinterpret_cast<i8*>(block.data()), block.size());
+
+    const auto receiveLine = [this, &buffer](u64 maxLength) {
+        return m_Socket->receiveUntil(buffer.data(), maxLength + 1, CRLF.data(), CRLF.size());
+    };
+
+    u64 requestLineLength = receiveLine(maxRequestLineLength);
     if (requestLineLength == 0) {
         // In the interest of robustness, a server that is expecting to receive and parse
         // a request-line *SHOULD* ignore at least one empty line (CRLF) received prior to 
         // the request-line.
         // 
         // https://datatracker.ietf.org/doc/html/rfc9112#section-2.2-6
-        requestLineLength = m_Socket->receiveUntil(buffer.data(), buffer.size(), CRLF.data(), CRLF.size());
+        requestLineLength = receiveLine(maxRequestLineLength);
+    }
+
+    if (requestLineLength > maxRequestLineLength) {
+        throw HttpException(StatusCode::URI_TOO_LONG, "Request line too long.");
+    }
+
+    const auto arrivalTime = std::chrono::steady_clock::now();
+
+    if (!m_Reservation.tryGrow(requestLineLength)) {
+        throw HttpException(StatusCode::SERVICE_UNAVAILABLE, "Memory budget exhausted.");
     }
 
-    auto methodEnd = std::find(buffer.begin(), buffer.end(), SP);
-    if (methodEnd == buffer.end()) {
-        throw std::runtime_error("Invalid request line.");
+    // Pooled memory is not cleared, so only the received line is parsed.
+    const auto lineEnd = buffer.begin() + requestLineLength;
+
+    auto methodEnd = std::find(buffer.begin(), lineEnd, SP);
+    if (methodEnd == lineEnd) {
+        throw HttpException(StatusCode::BAD_REQUEST, "Invalid request line.");
     }
     std::string_view method(buffer.begin(), methodEnd);
 
-    auto uriEnd = std::find(methodEnd + 1, buffer.end(), SP);
-    if (uriEnd == buffer.end()) {
-        throw std::runtime_error("Invalid request line.");
+    auto uriEnd = std::find(methodEnd + 1, lineEnd, SP);
+    if (uriEnd == lineEnd) {
+        throw HttpException(StatusCode::BAD_REQUEST, "Invalid request line.");
+    }
+    const std::string_view target(methodEnd + 1, uriEnd);
+
+    if (target.size() > settings.maxUriLength) {
+        throw HttpException(StatusCode::URI_TOO_LONG, "Request uri too long.");
     }
-    std::string uri(methodEnd + 1, uriEnd);
 
-    std::string_view version(uriEnd + 1, buffer.end());
+    // The line buffer is reused for the header fields, the target is kept in a block of its own,
+    // which does not move with the request.
+    m_Target = BufferPool::acquire(target.size());
+    std::copy(target.begin(), target.end(), reinterpret_cast<i8*>(m_Target.data()));
+    const u64 targetLength = target.size();
+
+    std::string_view version(uriEnd + 1, lineEnd);
     m_Version = getVersionFromString(version);
 
-    if (m_Version == HttpVersion::UNKNOWN || m_Version.major > 1) {
-        throw std::runtime_error(std::format("Invalid version detected {}.", m_Version));
+    if (m_Version == HttpVersion::UNKNOWN) {
+        throw HttpException(StatusCode::BAD_REQUEST, std::format("Invalid version detected {}.", m_Version));
+    }
+
+    if (m_Version.major > 1) {
+        throw HttpException(StatusCode::HTTP_VERSION_NOT_SUPPORTED, std::format("Invalid version detected {}.", m_Version));
     }
 
     m_Method = getMethodFromString(method);
     if (m_Method == HttpMethod::UNKNOWN) {
-        // TODO implement bad request exception
-        throw std::runtime_error(std::format("Invalid method detected {}.", method));
+        throw HttpException(StatusCode::NOT_IMPLEMENTED, std::format("Invalid method detected {}.", method));
     }
 
+    u64 headerFieldsSize = 0;
+    u64 headerFieldCount = 0;
     u64 headerFieldLen = 0;
     do {
-        headerFieldLen = m_Socket->receiveUntil(buffer.data(), buffer.size(), CRLF.data(), CRLF.size());
+        const u64 maxHeaderFieldLength = std::min(settings.maxHeaderFieldLength, settings.maxHeaderFieldsSize - headerFieldsSize);
+
+        headerFieldLen = receiveLine(maxHeaderFieldLength);
         if (headerFieldLen == 0)
             break;
 
+        if (headerFieldLen > maxHeaderFieldLength || ++headerFieldCount > settings.maxHeaderFieldCount) {
+            throw HttpException(StatusCode::REQUEST_HEADER_FIELDS_TOO_LARGE, "Header fields too large.");
+        }
+        headerFieldsSize += headerFieldLen;
+
+        if (!m_Reservation.tryGrow(headerFieldLen)) {
+            throw HttpException(StatusCode::SERVICE_UNAVAILABLE, "Memory budget exhausted.");
+        }
+
         auto end = buffer.begin() + headerFieldLen;
         auto colon = std::find(buffer.begin(), end, ':');
 
@@ -192,8 +346,7 @@ HttpRequest::HttpRequest(ClientSocket* socket)
         auto whiteSpaceFieldName = std::find_if(buffer.begin(), colon, isWhiteSpace);
 
         if (whiteSpaceFieldName != colon) {
-            // TODO implement bad request exception
-            throw std::runtime_error("Error while parsing Header fields.");
+            throw HttpException(StatusCode::BAD_REQUEST, "Error while parsing Header fields.");
         }
 
         if (colon == end)
@@ -208,8 +361,7 @@ HttpRequest::HttpRequest(ClientSocket* socket)
         for (; endField != beginField && isWhiteSpace(*beginField); --endField);
 
         if (std::distance(beginField, endField) == 0) {
-            // TODO implement bad request exception
-            throw std::runtime_error("Error while parsing Header fields.");
+            throw HttpException(StatusCode::BAD_REQUEST, "Error while parsing Header fields.");
         }
 
         m_HeaderFields.emplace(std::piecewise_construct,
@@ -220,32 +372,97 @@ HttpRequest::HttpRequest(ClientSocket* socket)
     auto hostsRange = m_HeaderFields.equal_range("host");
 
     if (std::distance(hostsRange.first, hostsRange.second) != 1) {
-        // TODO implement bad request exception
-        throw std::runtime_error("A valid Request must contain exactly one 'Host' field.");
+        throw HttpException(StatusCode::BAD_REQUEST, "A valid Request must contain exactly one 'Host' field.");
     }
 
     try
     {
-        m_Uri = URI("http://" + hostsRange.first->second + uri);
+        i8* targetData = reinterpret_cast<i8*>(m_Target.data());
+        m_Uri = URIView(std::string_view(targetData, removeDotSegments(targetData, targetLength)));
     }
     catch (...) {
-        // TODO implement bad request exception
-        throw std::runtime_error("Error while parsing the request uri.");
+        throw HttpException(StatusCode::BAD_REQUEST, "Error while parsing the request uri.");
     }
 
     auto contentLengthRange = m_HeaderFields.equal_range("content-length");
+    const auto contentLengthCount = std::distance(contentLengthRange.first, contentLengthRange.second);
+
+    if (contentLengthCount > 1) {
+        throw HttpException(StatusCode::BAD_REQUEST, "A valid Request must contain at most one 'Content-Length' field.");
+    }
 
-    if (std::distance(contentLengthRange.first, contentLengthRange.second) == 1) {
+    if (contentLengthCount == 1) {
         const auto& contentLength = contentLengthRange.first->second;
-        u64 len = 0;
-        if (std::from_chars(contentLength.data(), contentLength.data() + contentLength.size(), len).ec == std::errc()) {
-            m_Content.resize(len);
-            u64 received = m_Socket->receive(m_Content.data(), len);
-            if (received != len) {
-                // TODO: error?
+        auto [ptr, ec] = std::from_chars(contentLength.data(), contentLength.data() + contentLength.size(), m_ContentLength);
+
+        if (ec != std::errc() || ptr != contentLength.data() + contentLength.size()) {
+            throw HttpException(StatusCode::BAD_REQUEST, "Invalid 'Content-Length' field.");
+        }
+    }
+
+    if (settings.maxContentLength > 0 && m_ContentLength > settings.maxContentLength) {
+        throw HttpException(StatusCode::CONTENT_TOO_LARGE, "Content too large.");
+    }
+
+    // Expectations received in an HTTP/1.0 request are ignored, a 100-continue one *MUST* be.
+    //
+    // https://datatracker.ietf.org/doc/html/rfc9110#section-10.1.1
+    if (m_Version.major == 1 && m_Version.minor >= 1) {
+        auto expectRange = m_HeaderFields.equal_range("expect");
+        for (auto it = expectRange.first; it != expectRange.second; ++it) {
+            if (!ignoreCaseEquals(it->second, "100-continue")) {
+                throw HttpException(StatusCode::EXPECTATION_FAILED, std::format("Unsupported expectation {}.", it->second));
+            }
+
+            m_ExpectsContinue = m_ContentLength > 0;
+        }
+    }
+
+    // The content is accounted before anything is answered, so that a client expecting a 100 (Continue)
+    // is refused before sending a content that could not be received.
+    if (!m_Reservation.tryGrow(m_ContentLength)) {
+        throw HttpException(StatusCode::SERVICE_UNAVAILABLE, "Memory budget exhausted.");
+    }
+
+    std::chrono::milliseconds budget = settings.requestDeadline;
+
+    if (!settings.requestDeadlineField.empty()) {
+        auto deadlineRange = m_HeaderFields.equal_range(getFieldNameIgnoreCase(settings.requestDeadlineField));
+
+        if (std::distance(deadlineRange.first, deadlineRange.second) == 1) {
+            const auto& value = deadlineRange.first->second;
+            u64 milliseconds = 0;
+            if (std::from_chars(value.data(), value.data() + value.size(), milliseconds).ec == std::errc() && milliseconds > 0) {
+                milliseconds = std::min(milliseconds, MAX_REQUEST_DEADLINE_FIELD);
+
+                if (budget.count() == 0 || milliseconds < static_cast<u64>(budget.count())) {
+                    budget = std::chrono::milliseconds(milliseconds);
+                }
             }
         }
     }
+
+    if (budget.count() > 0) {
+        m_Deadline = arrivalTime + budget;
+    }
+
+}
+
+void HttpRequest::receiveContent() {
+    if (m_ContentLength == 0) {
+        return;
+    }
+
+    m_Content.resize(m_ContentLength);
+
+    u64 received = 0;
+    while (received < m_ContentLength) {
+        u64 byteRead = m_Socket->receive(m_Content.data() + received, m_ContentLength - received);
+        if (byteRead == 0) {
+            throw std::runtime_error("Connection closed while receiving the content.");
+        }
+        received += byteRead;
+    }
 }
 
 std::string HttpRequest::getFieldNameIgnoreCase(std::string_view name) const {
@@ -261,10 +478,24 @@ HttpMethod HttpRequest::getMethod() const {
     return m_Method;
 }
 
-const URI& HttpRequest::getURI() const {
+const URIView& HttpRequest::getURI() const {
     return m_Uri;
 }
 
+std::string_view HttpRequest::getHost() const {
+    auto it = m_HeaderFields.find("host");
+
+    if (it == m_HeaderFields.end()) {
+        return std::string_view();
+    }
+
+    return it->second;
+}
+
+const PathParameters& HttpRequest::getPathParameters() const {
+    return m_PathParameters;
+}
+
 void HttpRequest::setHeaderField(std::string_view _name, std::string_view value) {
     auto fieldName = _name | toLowerView;
     std::string name(fieldName.begin(), fieldName.end());
@@ -291,6 +522,81 @@ const std::vector<u8>& HttpRequest::getContent() const
     return m_Content;
 }
 
+const QueryParameters& HttpRequest::getQueryParameters() const {
+    if (!m_QueryParameters) {
+        m_QueryParameters.emplace(m_Uri.getQuery());
+    }
+
+    return *m_QueryParameters;
+}
+
+const QueryParameters& HttpRequest::getFormParameters() const {
+    if (m_FormParameters) {
+        return *m_FormParameters;
+    }
+
+    // Before the content is received, as in a request validator, the empty index must not be kept.
+    if (m_Content.size() < m_ContentLength) {
+        static const QueryParameters pendingContent;
+        return pendingContent;
+    }
+
+    constexpr std::string_view FORM_CONTENT_TYPE = "application/x-www-form-urlencoded";
+
+    auto it = m_HeaderFields.find("content-type");
+    bool isForm = it != m_HeaderFields.end() && it->second.size() >= FORM_CONTENT_TYPE.size() &&
+        std::ranges::equal(std::string_view(it->second).substr(0, FORM_CONTENT_TYPE.size()), FORM_CONTENT_TYPE,
+            [](char a, char b) { return std::tolower(static_cast<u8>(a)) == b; });
+
+    // The media type must end there, only parameters such as "; charset=utf-8" may follow.
+    if (isForm && it->second.size() > FORM_CONTENT_TYPE.size()) {
+        const char next = it->second[FORM_CONTENT_TYPE.size()];
+        isForm = next == ';' || next == ' ' || next == '\t';
+    }
+
+    if (isForm) {
+        m_FormParameters.emplace(std::string_view(reinterpret_cast<const char*>(m_Content.data()), m_Content.size()));
+    }
+    else {
+        m_FormParameters.emplace();
+    }
+
+    return *m_FormParameters;
+}
+
+u64 HttpRequest::getContentLength() const {
+    return m_ContentLength;
+}
+
+bool HttpRequest::expectsContinue() const {
+    return m_ExpectsContinue;
+}
+
+bool HttpRequest::hasDeadline() const {
+    return m_Deadline != std::chrono::steady_clock::time_point::max();
+}
+
+std::chrono::steady_clock::time_point HttpRequest::getDeadline() const {
+    return m_Deadline;
+}
+
+std::chrono::steady_clock::duration HttpRequest::getRemainingBudget() const {
+    if (!hasDeadline()) {
+        return std::chrono::steady_clock::duration::max();
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now >= m_Deadline) {
+        return std::chrono::steady_clock::duration::zero();
+    }
+
+    return m_Deadline - now;
+}
+
+bool HttpRequest::isExpired() const {
+    return hasDeadline() && std::chrono::steady_clock::now() >= m_Deadline;
+}
+
 void HttpRequest::addHeaderField(std::string_view name, std::string_view value) {
     auto fieldName = name | toLowerView;
     m_HeaderFields.emplace(std::piecewise_construct,
@@ -300,8 +606,8 @@ void HttpRequest::addHeaderField(std::string_view name, std::string_view value)
 
 HttpRequest::~HttpRequest() {}
 
-HttpResponse::HttpResponse(ClientSocket* socket)
-    : m_Socket(socket) {}
+HttpResponse::HttpResponse(ClientSocket* socket, std::chrono::milliseconds sendTimeout, MemoryBudget* budget)
+    : m_Socket(socket), m_SendTimeout(sendTimeout), m_Reservation(budget) {}
 
 HttpResponse::~HttpResponse() {}
 
@@ -330,11 +636,23 @@ void HttpResponse::setUseDefaultReasonPhrase(bool v) {
 }
 
 void HttpResponse::addHeaderField(std::string_view name, std::string_view value) {
-    m_HeaderFields.emplace_back(name, value);
+    // The response is already being produced, so it is accounted even past the limit.
+    m_Reservation.grow(name.size() + value.size());
+
+    m_HeaderBlock.append(name);
+    m_HeaderBlock.append(": ");
+    m_HeaderBlock.append(value);
+    m_HeaderBlock.append("\r\n");
+}
+
+void HttpResponse::addHeaderBlock(std::string_view block) {
+    m_Reservation.grow(block.size());
+    m_HeaderBlock.append(block);
 }
 
 void HttpResponse::clearHeaderFields() {
-    m_HeaderFields.clear();
+    m_HeaderBlock.clear();
+    m_Reservation.clear();
 }
 
 bool HttpResponse::wasSent() const {
@@ -345,129 +663,150 @@ void HttpResponse::send() {
     send(nullptr);
 }
 
-void HttpResponse::send(std::function<void(ClientSocket*)> body) {
+void HttpResponse::send(ResponseBody body) {
     if (m_WasSent)
         return;
 
     m_WasSent = true;
+    m_Body = std::move(body);
+
+    if (!m_DeferSend) {
+        flush();
+    }
+}
+
+void HttpResponse::setDeferSend(bool v) {
+    m_DeferSend = v;
+}
+
+void HttpResponse::flush() {
+    if (!m_WasSent || m_Flushed)
+        return;
+
+    m_Flushed = true;
+
+    // A client that stops reading the response cannot hold the connection forever.
+    m_Socket->startTimeout(m_SendTimeout, true);
 
     if (m_UseDefaultReasonPhrase) {
         generateDefaultReasonPhrase();
     }
 
-    auto statusLine = std::format("{} {} {}\r\n", m_Version, m_StatusCode, m_ReasonPhrase);
+    auto head = std::format("{} {} {}\r\n", m_Version, m_StatusCode, m_ReasonPhrase);
+    head.reserve(head.size() + m_HeaderBlock.size() + 2);
+    head.append(m_HeaderBlock);
+    head.append("\r\n");
 
-    m_Socket->send(statusLine.data(), statusLine.size());
-    for (auto& headerField : m_HeaderFields) {
-        auto field = std::format("{}: {}\r\n", headerField.first, headerField.second);
-        m_Socket->send(field.data(), field.size());
-    }
-    m_Socket->send("\r\n", 2);
+    m_Socket->send(head.data(), head.size());
 
-    if (body) {
-        body(m_Socket);
+    if (m_Body) {
+        m_Body(m_Socket);
+        m_Body = nullptr;
     }
+
+    m_Socket->stopTimeout();
 }
 
 void HttpResponse::generateDefaultReasonPhrase() {
     m_UseDefaultReasonPhrase = true;
 
-    StatusCode code = static_cast<StatusCode>(m_StatusCode);
+    if (const char* reason = getDefaultReasonPhrase(static_cast<StatusCode>(m_StatusCode))) {
+        m_ReasonPhrase = reason;
+    }
+}
+
+std::string formatHttpDate(std::chrono::system_clock::time_point time) {
+    static constexpr std::array<std::string_view, 7> DAY_NAMES = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static constexpr std::array<std::string_view, 12> MONTH_NAMES = {
+        "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+    const auto seconds = std::chrono::floor<std::chrono::seconds>(time);
+    const auto days = std::chrono::floor<std::chrono::days>(seconds);
+    const std::chrono::year_month_day date(days);
+    const std::chrono::hh_mm_ss clock(seconds - days);
+
+    std::string result;
+    result.reserve(29);
+
+    const auto appendNumber = [&result](u64 value, u64 digits) {
+        std::array<char, 4> buffer{};
+        for (u64 i = digits; i-- > 0; value /= 10) {
+            buffer[i] = static_cast<char>('0' + value % 10);
+        }
+        result.append(buffer.data(), digits);
+    };
+
+    result.append(DAY_NAMES[std::chrono::weekday(days).c_encoding()]);
+    result.append(", ");
+    appendNumber(static_cast<unsigned>(date.day()), 2);
+    result.push_back(' ');
+    result.append(MONTH_NAMES[static_cast<unsigned>(date.month()) - 1]);
+    result.push_back(' ');
+    appendNumber(static_cast<int>(date.year()), 4);
+    result.push_back(' ');
+    appendNumber(clock.hours().count(), 2);
+    result.push_back(':');
+    appendNumber(clock.minutes().count(), 2);
+    result.push_back(':');
+    appendNumber(clock.seconds().count(), 2);
+    result.append(" GMT");
 
+    return result;
+}
+
+const char* getDefaultReasonPhrase(StatusCode code) {
     switch (code) {
-    case simpleHTTP::StatusCode::CONTINUE: m_ReasonPhrase = "Continue";
-        break;
-    case simpleHTTP::StatusCode::SWITCHING_PROTOCOLS: m_ReasonPhrase = "Switching Protocols";
-        break;
-    case simpleHTTP::StatusCode::OK: m_ReasonPhrase = "OK";
-        break;
-    case simpleHTTP::StatusCode::CREATED: m_ReasonPhrase = "Created";
-        break;
-    case simpleHTTP::StatusCode::ACCEPTED: m_ReasonPhrase = "Accepted";
-        break;
-    case simpleHTTP::StatusCode::NON_AUTHORITATIVE_INFORMATION: m_ReasonPhrase = "Non-Authoritative Information";
-        break;
-    case simpleHTTP::StatusCode::NO_CONTENT: m_ReasonPhrase = "No Content";
-        break;
-    case simpleHTTP::StatusCode::RESET_REQUEST: m_ReasonPhrase = "Reset Content";
-        break;
-    case simpleHTTP::StatusCode::PARTIAL_CONTENT: m_ReasonPhrase = "Partial Content";
-        break;
-    case simpleHTTP::StatusCode::MULTIPLE_CHOICES: m_ReasonPhrase = "Multiple Choices";
-        break;
-    case simpleHTTP::StatusCode::MOVED_PERMANENTLY: m_ReasonPhrase = "Moved Permanently";
-        break;
-    case simpleHTTP::StatusCode::FOUND: m_ReasonPhrase = "Found";
-        break;
-    case simpleHTTP::StatusCode::SEE_OTHER: m_ReasonPhrase = "See Other";
-        break;
-    case simpleHTTP::StatusCode::NOT_MODIFIED: m_ReasonPhrase = "Not Modified";
-        break;
-    case simpleHTTP::StatusCode::USE_PROXY: m_ReasonPhrase = "Use Proxy";
-        break;
-    case simpleHTTP::StatusCode::TEMPORARY_REDIRECT: m_ReasonPhrase = "Temporary Redirect";
-        break;
-    case simpleHTTP::StatusCode::PERMANENT_REDIRECT: m_ReasonPhrase = "Permanent Redirect";
-        break;
-    case simpleHTTP::StatusCode::BAD_REQUEST: m_ReasonPhrase = "Bad Request";
-        break;
-    case simpleHTTP::StatusCode::UNAUTHORIZED: m_ReasonPhrase = "Unauthorized";
-        break;
-    case simpleHTTP::StatusCode::PAYMENT_REQUIRED: m_ReasonPhrase = "Payment Required";
-        break;
-    case simpleHTTP::StatusCode::FORBIDDEN: m_ReasonPhrase = "Forbidden";
-        break;
-    case simpleHTTP::StatusCode::NOT_FOUND: m_ReasonPhrase = "Not Found";
-        break;
-    case simpleHTTP::StatusCode::METHOD_NOT_ALLOWED: m_ReasonPhrase = "Method Not Allowed";
-        break;
-    case simpleHTTP::StatusCode::NOT_ACCEPTABLE: m_ReasonPhrase = "Not Acceptable";
-        break;
-    case simpleHTTP::StatusCode::PROXY_AUTHENTICATION_REQUIRED: m_ReasonPhrase = "Proxy Authentication Required";
-        break;
-    case simpleHTTP::StatusCode::REQUEST_TIMEOUT: m_ReasonPhrase = "Request Timeout";
-        break;
-    case simpleHTTP::StatusCode::CONFLICT: m_ReasonPhrase = "Conflict";
-        break;
-    case simpleHTTP::StatusCode::GONE: m_ReasonPhrase = "Gone";
-        break;
-    case simpleHTTP::StatusCode::LENGTH_REQUIRED: m_ReasonPhrase = "Length Required";
-        break;
-    case simpleHTTP::StatusCode::PRECONDITION_FAILED: m_ReasonPhrase = "Precondition Failed";
-        break;
-    case simpleHTTP::StatusCode::CONTENT_TOO_LARGE: m_ReasonPhrase = "Content Too Large";
-        break;
-    case simpleHTTP::StatusCode::URI_TOO_LONG: m_ReasonPhrase = "URI Too Long";
-        break;
-    case simpleHTTP::StatusCode::UNSUPPORTED_MEDIA_TYPE: m_ReasonPhrase = "Unsupported Media Type";
-        break;
-    case simpleHTTP::StatusCode::RANGE_NOT_SATISFIABLE: m_ReasonPhrase = "Range Not Satisfiable";
-        break;
-    case simpleHTTP::StatusCode::EXPECTATION_FAILED: m_ReasonPhrase = "Expectation Failed";
-        break;
-    case simpleHTTP::StatusCode::I_AM_A_TEAPOT: m_ReasonPhrase = "I'm a Teapot";
-        break;
-    case simpleHTTP::StatusCode::MISDIRECTED_REQUEST: m_ReasonPhrase = "Misdirected Request";
-        break;
-    case simpleHTTP::StatusCode::UNPROCESSABLE_CONTENT: m_ReasonPhrase = "Unprocessable Content";
-        break;
-    case simpleHTTP::StatusCode::UPGRADE_REQUIRED: m_ReasonPhrase = "Upgrade Required";
-        break;
-    case simpleHTTP::StatusCode::INTERNAL_SERVER_ERROR: m_ReasonPhrase = "Internal Server Error";
-        break;
-    case simpleHTTP::StatusCode::NOT_IMPLEMENTED: m_ReasonPhrase = "Not Implemented";
-        break;
-    case simpleHTTP::StatusCode::BAD_GATEWAY: m_ReasonPhrase = "Bad Gateway";
-        break;
-    case simpleHTTP::StatusCode::SERVICE_UNAVAILABLE: m_ReasonPhrase = "Service Unavailable";
-        break;
-    case simpleHTTP::StatusCode::GATEWAY_TIMEOUT: m_ReasonPhrase = "Gateway Timeout";
-        break;
-    case simpleHTTP::StatusCode::HTTP_VERSION_NOT_SUPPORTED: m_ReasonPhrase = "HTTP Version Not Supported";
-        break;
+    case simpleHTTP::StatusCode::CONTINUE: return "Continue";
+    case simpleHTTP::StatusCode::SWITCHING_PROTOCOLS: return "Switching Protocols";
+    case simpleHTTP::StatusCode::OK: return "OK";
+    case simpleHTTP::StatusCode::CREATED: return "Created";
+    case simpleHTTP::StatusCode::ACCEPTED: return "Accepted";
+    case simpleHTTP::StatusCode::NON_AUTHORITATIVE_INFORMATION: return "Non-Authoritative Information";
+    case simpleHTTP::StatusCode::NO_CONTENT: return "No Content";
+    case simpleHTTP::StatusCode::RESET_REQUEST: return "Reset Content";
+    case simpleHTTP::StatusCode::PARTIAL_CONTENT: return "Partial Content";
+    case simpleHTTP::StatusCode::MULTIPLE_CHOICES: return "Multiple Choices";
+    case simpleHTTP::StatusCode::MOVED_PERMANENTLY: return "Moved Permanently";
+    case simpleHTTP::StatusCode::FOUND: return "Found";
+    case simpleHTTP::StatusCode::SEE_OTHER: return "See Other";
+    case simpleHTTP::StatusCode::NOT_MODIFIED: return "Not Modified";
+    case simpleHTTP::StatusCode::USE_PROXY: return "Use Proxy";
+    case simpleHTTP::StatusCode::TEMPORARY_REDIRECT: return "Temporary Redirect";
+    case simpleHTTP::StatusCode::PERMANENT_REDIRECT: return "Permanent Redirect";
+    case simpleHTTP::StatusCode::BAD_REQUEST: return "Bad Request";
+    case simpleHTTP::StatusCode::UNAUTHORIZED: return "Unauthorized";
+    case simpleHTTP::StatusCode::PAYMENT_REQUIRED: return "Payment Required";
+    case simpleHTTP::StatusCode::FORBIDDEN: return "Forbidden";
+    case simpleHTTP::StatusCode::NOT_FOUND: return "Not Found";
+    case simpleHTTP::StatusCode::METHOD_NOT_ALLOWED: return "Method Not Allowed";
+    case simpleHTTP::StatusCode::NOT_ACCEPTABLE: return "Not Acceptable";
+    case simpleHTTP::StatusCode::PROXY_AUTHENTICATION_REQUIRED: return "Proxy Authentication Required";
+    case simpleHTTP::StatusCode::REQUEST_TIMEOUT: return "Request Timeout";
+    case simpleHTTP::StatusCode::CONFLICT: return "Conflict";
+    case simpleHTTP::StatusCode::GONE: return "Gone";
+    case simpleHTTP::StatusCode::LENGTH_REQUIRED: return "Length Required";
+    case simpleHTTP::StatusCode::PRECONDITION_FAILED: return "Precondition Failed";
+    case simpleHTTP::StatusCode::CONTENT_TOO_LARGE: return "Content Too Large";
+    case simpleHTTP::StatusCode::URI_TOO_LONG: return "URI Too Long";
+    case simpleHTTP::StatusCode::UNSUPPORTED_MEDIA_TYPE: return "Unsupported Media Type";
+    case simpleHTTP::StatusCode::RANGE_NOT_SATISFIABLE: return "Range Not Satisfiable";
+    case simpleHTTP::StatusCode::EXPECTATION_FAILED: return "Expectation Failed";
+    case simpleHTTP::StatusCode::I_AM_A_TEAPOT: return "I'm a Teapot";
+    case simpleHTTP::StatusCode::MISDIRECTED_REQUEST: return "Misdirected Request";
+    case simpleHTTP::StatusCode::UNPROCESSABLE_CONTENT: return "Unprocessable Content";
+    case simpleHTTP::StatusCode::UPGRADE_REQUIRED: return "Upgrade Required";
+    case simpleHTTP::StatusCode::REQUEST_HEADER_FIELDS_TOO_LARGE: return "Request Header Fields Too Large";
+    case simpleHTTP::StatusCode::INTERNAL_SERVER_ERROR: return "Internal Server Error";
+    case simpleHTTP::StatusCode::NOT_IMPLEMENTED: return "Not Implemented";
+    case simpleHTTP::StatusCode::BAD_GATEWAY: return "Bad Gateway";
+    case simpleHTTP::StatusCode::SERVICE_UNAVAILABLE: return "Service Unavailable";
+    case simpleHTTP::StatusCode::GATEWAY_TIMEOUT: return "Gateway Timeout";
+    case simpleHTTP::StatusCode::HTTP_VERSION_NOT_SUPPORTED: return "HTTP Version Not Supported";
     default:
         break;
     }
+
+    return nullptr;
 }
 
 const char* httpMethodToString(HttpMethod m) {
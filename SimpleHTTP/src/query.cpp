@@ -0,0 +1,83 @@
+#include <SimpleHTTP/query.h>
+#include <hex.h>
+
+#include <algorithm>
+#include <memory>
+
+namespace simpleHTTP {
+
+QueryParameters::QueryParameters(std::string_view text) {
+    // Decoding never lengthens the text, so one arena of its size holds every decoded part.
+    if (text.find_first_of("%+") != std::string_view::npos) {
+        m_Arena = std::make_unique_for_overwrite<char[]>(text.size());
+    }
+
+    m_Parameters.reserve(std::ranges::count(text, '&') + 1);
+
+    while (!text.empty()) {
+        const auto separator = text.find('&');
+        const std::string_view pair = text.substr(0, separator);
+        text = separator == std::string_view::npos ? std::string_view() : text.substr(separator + 1);
+
+        if (pair.empty()) {
+            continue;
+        }
+
+        const auto equal = pair.find('=');
+        const std::string_view name = pair.substr(0, equal);
+        const std::string_view value = equal == std::string_view::npos ? std::string_view() : pair.substr(equal + 1);
+
+        m_Parameters.emplace_back(decode(name), decode(value));
+    }
+}
+
+std::optional<std::string_view> QueryParameters::get(std::string_view name) const {
+    auto it = std::ranges::find(m_Parameters, name, &Parameter::first);
+
+    if (it == m_Parameters.end()) {
+        return std::nullopt;
+    }
+
+    return it->second;
+}
+
+bool QueryParameters::contains(std::string_view name) const {
+    return std::ranges::find(m_Parameters, name, &Parameter::first) != m_Parameters.end();
+}
+
+u64 QueryParameters::size() const {
+    return m_Parameters.size();
+}
+
+bool QueryParameters::empty() const {
+    return m_Parameters.empty();
+}
+
+std::string_view QueryParameters::decode(std::string_view text) {
+    if (text.find_first_of("%+") == std::string_view::npos) {
+        return text;
+    }
+
+    char* const begin = m_Arena.get() + m_ArenaSize;
+    char* out = begin;
+
+    for (u64 i = 0; i < text.size(); ++i) {
+        const char c = text[i];
+
+        if (c == '+') {
+            *out++ = ' ';
+        }
+        else if (c == '%' && i + 2 < text.size() && isHex(text[i + 1]) && isHex(text[i + 2])) {
+            *out++ = static_cast<char>(hexValue(text[i + 1]) << 4 | hexValue(text[i + 2]));
+            i += 2;
+        }
+        else {
+            *out++ = c;
+        }
+    }
+
+    m_ArenaSize += out - begin;
+    return std::string_view(begin, out);
+}
+
+} // namespace simpleHTTP
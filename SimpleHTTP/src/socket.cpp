@@ -1,28 +1,26 @@
 #include <SimpleHTTP/socket.h>
 
 #include <algorithm>
+#include <cstring>
 
 namespace simpleHTTP {
 
 simpleHTTP::ClientSocket::ClientSocket(Ref<ClientSocketImpl>&& impl)
-    : m_Implementation(impl) {
-    m_Cache.resize(SOCKET_BUFFER_SIZE);
-    m_CacheRange = { m_Cache.begin(), m_Cache.begin() };
-}
+    : m_Implementation(std::move(impl)) {}
 
 u64 ClientSocket::receive(void* buf, u64 size) {
-    const u64 rangeSize = m_CacheRange.size();
+    const u64 rangeSize = m_CacheEnd - m_CacheBegin;
     if (rangeSize > 0) {
         if (rangeSize >= size) {
-            std::memcpy(buf, m_CacheRange.data(), size);
-            m_CacheRange = { m_CacheRange.begin() + size, m_CacheRange.end() };
+            std::memcpy(buf, m_Cache.data() + m_CacheBegin, size);
+            m_CacheBegin += size;
             return size;
         }
 
-        std::memcpy(buf, m_CacheRange.data(), rangeSize);
+        std::memcpy(buf, m_Cache.data() + m_CacheBegin, rangeSize);
         buf = static_cast<i8*>(buf) + rangeSize;
         size -= rangeSize;
-        m_CacheRange = { m_CacheRange.end(), m_CacheRange.end() };
+        m_CacheBegin = m_CacheEnd;
     }
 
     return rangeSize + m_Implementation->receive(buf, size);
@@ -40,34 +38,110 @@ u64 ClientSocket::receiveUntil(void* _buf, u64 size, const void* _delimiter, u64
     constexpr u32 MAX_NULL_READ = 16;
 
     while (!match && outLen < size && nullRead < MAX_NULL_READ) {
-        if (m_CacheRange.size() <= 0) {
-            u64 byteRead = m_Implementation->receive(m_Cache.data(), SOCKET_BUFFER_SIZE);
+        if (m_CacheEnd <= m_CacheBegin) {
+            u64 byteRead = fillCache();
             if (byteRead == 0)
                 ++nullRead;
-            m_CacheRange = { m_Cache.begin(), byteRead };
         }
 
-        auto find = std::search(m_CacheRange.begin(), m_CacheRange.end(), delimiter, delimiter + delimiterSize);
+        std::span<u8> cacheRange(m_Cache.data() + m_CacheBegin, m_Cache.data() + m_CacheEnd);
+
+        auto find = std::search(cacheRange.begin(), cacheRange.end(), delimiter, delimiter + delimiterSize);
 
-        u64 toCopy = std::distance(m_CacheRange.begin(), find);
+        u64 toCopy = std::distance(cacheRange.begin(), find);
         toCopy = std::min(toCopy, size - outLen);
 
-        bufIt = std::copy(m_CacheRange.begin(), m_CacheRange.begin() + toCopy, bufIt);
+        bufIt = std::copy(cacheRange.begin(), cacheRange.begin() + toCopy, bufIt);
         outLen += toCopy;
 
-        match = find != m_CacheRange.end();
+        match = find != cacheRange.end();
 
-        if (m_CacheRange.size() < toCopy + delimiterSize) {
-            m_CacheRange = { m_CacheRange.begin(), m_CacheRange.begin() };
+        if (cacheRange.size() < toCopy + delimiterSize) {
+            m_CacheEnd = m_CacheBegin;
             continue;
         }
 
-        m_CacheRange = { m_CacheRange.begin() + toCopy + delimiterSize, m_CacheRange.end() };
+        m_CacheBegin += toCopy + delimiterSize;
     }
 
     return outLen;
 }
 
+bool ClientSocket::waitForData() {
+    if (m_CacheEnd > m_CacheBegin) {
+        return true;
+    }
+
+    // No buffer is held while the connection is idle.
+    m_Implementation->waitReadable();
+
+    if (fillCache() > 0) {
+        return true;
+    }
+
+    releaseCache();
+    return false;
+}
+
+void ClientSocket::releaseCache() {
+    if (m_CacheEnd > m_CacheBegin) {
+        return;
+    }
+
+    m_Cache = Buffer();
+    m_CacheBegin = 0;
+    m_CacheEnd = 0;
+}
+
+u64 ClientSocket::fillCache() {
+    if (!m_Cache) {
+        m_Cache = BufferPool::acquire(SOCKET_BUFFER_SIZE);
+    }
+
+    m_CacheBegin = 0;
+    m_CacheEnd = m_Implementation->receive(m_Cache.data(), m_Cache.size());
+    return m_CacheEnd;
+}
+
+void ClientSocket::setTimerWheel(const Ref<TimerWheel>& wheel) {
+    m_Timeout = std::make_unique<Timer>(wheel, [implementation = WRef<ClientSocketImpl>(m_Implementation)] {
+        if (auto socket = implementation.lock()) {
+            socket->shutdown();
+        }
+    });
+}
+
+void ClientSocket::startTimeout(std::chrono::milliseconds timeout, bool restartOnSend) {
+    if (!m_Timeout) {
+        return;
+    }
+
+    m_RestartTimeoutOnSend = restartOnSend && timeout.count() > 0;
+    m_Timeout->start(timeout);
+}
+
+void ClientSocket::stopTimeout() {
+    if (!m_Timeout) {
+        return;
+    }
+
+    m_RestartTimeoutOnSend = false;
+    m_Timeout->stop();
+}
+
+void ClientSocket::close() {
+    // The timeout must not shut down the socket descriptor once it is released.
+    stopTimeout();
+
+    if (m_Implementation) {
+        m_Implementation->close();
+    }
+
+    m_Cache = Buffer();
+    m_CacheBegin = 0;
+    m_CacheEnd = 0;
+}
+
 ServerSocket::ServerSocket(u16 port)
     : m_Implementation(make(port)) {}
 
@@ -0,0 +1,180 @@
+#include <SimpleHTTP/timer.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace simpleHTTP {
+
+Timer::Timer(const Ref<TimerWheel>& wheel, Callback callback)
+    : m_Wheel(wheel), m_Callback(std::move(callback)) {}
+
+// The wheel is kept alive by the calling thread while it is used. Once it is destroyed, the timer was
+// unlinked from its slots and is never armed again.
+
+void Timer::start(std::chrono::milliseconds timeout) {
+    if (auto wheel = m_Wheel.lock()) {
+        wheel->schedule(*this, timeout);
+    }
+}
+
+void Timer::restart() {
+    if (auto wheel = m_Wheel.lock()) {
+        wheel->schedule(*this, m_Timeout);
+    }
+}
+
+void Timer::stop() {
+    if (auto wheel = m_Wheel.lock()) {
+        wheel->cancel(*this);
+    }
+}
+
+bool Timer::isArmed() const {
+    auto wheel = m_Wheel.lock();
+    if (!wheel) {
+        return false;
+    }
+
+    std::scoped_lock lk(wheel->m_Mutex);
+    return m_Slot != nullptr;
+}
+
+Timer::~Timer() {
+    stop();
+}
+
+TimerWheel::TimerWheel(std::chrono::milliseconds resolution)
+    : m_Resolution(std::max(resolution, std::chrono::milliseconds(1))),
+    m_Start(std::chrono::steady_clock::now()) {}
+
+std::chrono::milliseconds TimerWheel::getResolution() const {
+    return m_Resolution;
+}
+
+void TimerWheel::advance() {
+    const u64 targetTick = static_cast<u64>((std::chrono::steady_clock::now() - m_Start) / m_Resolution);
+
+    std::scoped_lock lk(m_Mutex);
+
+    while (m_CurrentTick < targetTick) {
+        ++m_CurrentTick;
+
+        // Higher levels first, since they may move timers into the lower slots processed in this tick.
+        for (u64 level = LEVEL_COUNT - 1; level > 0; --level) {
+            const u64 levelMask = (u64(1) << (SLOT_BITS * level)) - 1;
+            if ((m_CurrentTick & levelMask) == 0) {
+                cascade(level);
+            }
+        }
+
+        Timer* timer = std::exchange(m_Slots[0][m_CurrentTick & SLOT_MASK], nullptr);
+        while (timer) {
+            Timer* next = timer->m_Next;
+            timer->m_Previous = nullptr;
+            timer->m_Next = nullptr;
+            timer->m_Slot = nullptr;
+
+            if (timer->m_Expiration > m_CurrentTick) {
+                // The expiration was beyond the range of the wheel.
+                insert(*timer);
+            }
+            else if (timer->m_Callback) {
+                timer->m_Callback();
+            }
+
+            timer = next;
+        }
+    }
+}
+
+TimerWheel::~TimerWheel() {
+    std::scoped_lock lk(m_Mutex);
+
+    for (auto& level : m_Slots) {
+        for (auto& slot : level) {
+            while (slot) {
+                remove(*slot);
+            }
+        }
+    }
+}
+
+void TimerWheel::schedule(Timer& timer, std::chrono::milliseconds timeout) {
+    std::scoped_lock lk(m_Mutex);
+
+    if (timer.m_Slot) {
+        remove(timer);
+    }
+
+    timer.m_Timeout = timeout;
+    if (timeout.count() <= 0) {
+        return;
+    }
+
+    // Measured from the current time, since the wheel may be behind by up to a tick.
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_Start);
+    timer.m_Expiration = static_cast<u64>((elapsed + timeout + m_Resolution - std::chrono::milliseconds(1)) / m_Resolution);
+    insert(timer);
+}
+
+void TimerWheel::cancel(Timer& timer) {
+    std::scoped_lock lk(m_Mutex);
+
+    if (timer.m_Slot) {
+        remove(timer);
+    }
+}
+
+void TimerWheel::insert(Timer& timer) {
+    const u64 expiration = std::max(timer.m_Expiration, m_CurrentTick + 1);
+    const u64 delta = expiration - m_CurrentTick;
+
+    u64 level = 0;
+    while (level < LEVEL_COUNT - 1 && delta >= (u64(1) << (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+
+    Timer*& head = m_Slots[level][(expiration >> (SLOT_BITS * level)) & SLOT_MASK];
+
+    timer.m_Previous = nullptr;
+    timer.m_Next = head;
+    timer.m_Slot = &head;
+    if (head) {
+        head->m_Previous = &timer;
+    }
+    head = &timer;
+}
+
+void TimerWheel::remove(Timer& timer) {
+    if (timer.m_Previous) {
+        timer.m_Previous->m_Next = timer.m_Next;
+    }
+    else {
+        *timer.m_Slot = timer.m_Next;
+    }
+
+    if (timer.m_Next) {
+        timer.m_Next->m_Previous = timer.m_Previous;
+    }
+
+    timer.m_Previous = nullptr;
+    timer.m_Next = nullptr;
+    timer.m_Slot = nullptr;
+}
+
+void TimerWheel::cascade(u64 level) {
+    Timer* timer = std::exchange(m_Slots[level][(m_CurrentTick >> (SLOT_BITS * level)) & SLOT_MASK], nullptr);
+
+    while (timer) {
+        Timer* next = timer->m_Next;
+        timer->m_Previous = nullptr;
+        timer->m_Next = nullptr;
+        timer->m_Slot = nullptr;
+
+        insert(*timer);
+
+        timer = next;
+    }
+}
+
+} // namespace simpleHTTP
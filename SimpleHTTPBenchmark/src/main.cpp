@@ -0,0 +1,112 @@
+#include <SimpleHTTP/URI.h>
+#include <SimpleHTTP/types.h>
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+using namespace simpleHTTP;
+
+static constexpr char hexToHChar(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+
+    return 0;
+}
+
+static constexpr bool isSafePathChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == ' ' || c < 0;
+}
+
+/// @brief Decoder used by operator/ before decodePath, kept as the baseline of the benchmark.
+/// It builds a string one character at a time and drops decoded characters that are not alphanumeric.
+static std::string legacyDecodePath(std::string_view segment) {
+    std::string filterSegment;
+
+    for (auto c = segment.begin(); c != segment.end(); ++c) {
+        if (*c != '%') {
+            filterSegment.push_back(*c);
+            continue;
+        }
+
+        // Unlike the original loop, a truncated escape stops the decoding instead of reading past the path.
+        if (segment.end() - c < 3) {
+            break;
+        }
+
+        const char c1 = *++c;
+        const char c2 = *++c;
+
+        const char r = static_cast<char>(hexToHChar(c1) << 4 | hexToHChar(c2));
+        if (isSafePathChar(r)) {
+            filterSegment.push_back(r);
+        }
+    }
+
+    return filterSegment;
+}
+
+struct BenchmarkPath
+{
+    const char* name;
+    std::string_view path;
+};
+
+static constexpr std::array<BenchmarkPath, 5> PATHS{ {
+    { "short", "index.html" },
+    { "asset", "assets/js/vendor/app.3f9a2c1b7e.min.js" },
+    { "deep", "static/media/images/gallery/2024/summer/thumbnails/large/IMG_0042.jpg" },
+    { "spaces", "docs/user%20guide/getting%20started%20with%20the%20server.pdf" },
+    { "utf-8", "docs/%E6%96%87%E6%A1%A3/%E8%AF%B4%E6%98%8E%E4%B9%A6.pdf" },
+} };
+
+static constexpr u64 ITERATIONS = 2000000;
+
+/// @brief Returns the mean time of a call in nanoseconds.
+/// The sink accumulates the results, so that the compiler cannot drop the calls.
+template<typename Func>
+static double measure(Func&& func, u64& sink) {
+    const auto start = std::chrono::steady_clock::now();
+
+    for (u64 i = 0; i < ITERATIONS; ++i) {
+        sink += func();
+    }
+
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ITERATIONS;
+}
+
+int main() {
+    u64 sink = 0;
+    std::array<char, 256> buffer;
+
+    std::cout << "path\tlength\tlegacy (ns)\tdecodePath (ns)\tspeedup\n";
+
+    for (const auto& [name, path] : PATHS) {
+        const double legacy = measure([path] {
+            return legacyDecodePath(path).size();
+        }, sink);
+
+        const double decoded = measure([path, &buffer] {
+            return decodePath(path, buffer).value_or(0);
+        }, sink);
+
+        std::cout << name << '\t' << path.size() << '\t' << legacy << '\t' << decoded << '\t' << legacy / decoded << "x\n";
+    }
+
+    // Printed so that the measured calls have an observable effect.
+    std::cout << "checksum: " << sink << std::endl;
+
+    return 0;
+}
@@ -10,8 +10,16 @@ using namespace simpleHTTP;
 
 static std::filesystem::path serverRootPath = "data";
 
-static std::filesystem::path getPathFromURI(const URI& uri) {
-    auto path = serverRootPath / uri;
+static std::filesystem::path getPathFromURI(const URIView& uri) {
+    std::filesystem::path path;
+    try {
+        path = serverRootPath / uri;
+    }
+    catch (const std::runtime_error&) {
+        // Malformed or escaping paths are reported as not found.
+        return std::filesystem::path();
+    }
+
     std::error_code ec;
 
     if (std::filesystem::equivalent(path, serverRootPath, ec)) {
@@ -83,7 +91,24 @@ int main(int argc, char const* argv[]) {
     try {
         printInfo();
 
+        DefaultRequestHandlerSettings defaultRequestHandlerSettings{};
+
+        defaultRequestHandlerSettings.registerRequestProcessor("/", {
+                                                                   { HttpMethod::GET, getProcess},
+                                                                   { HttpMethod::HEAD, headProcess}
+            });
+
+        DefaultRequestHandler requestHandler(defaultRequestHandlerSettings);
+
         HttpServerSettings s{};
+        s.idleTimeout = std::chrono::seconds(10);
+        s.headerTimeout = std::chrono::seconds(10);
+        s.contentTimeout = std::chrono::seconds(30);
+        s.sendTimeout = std::chrono::seconds(30);
+        s.memoryBudget = 0x10000000;
+        s.requestValidator = [&requestHandler](const HttpRequest& request) {
+            requestHandler.validateRequest(request);
+        };
         HttpServer server{ s };
 
         std::cout << "\nLocal Address: http://" << getDefaultAddress().value << ":" << server.getPort() << std::endl;
@@ -96,15 +121,6 @@ int main(int argc, char const* argv[]) {
             server.stop();
         });
 
-        DefaultRequestHandlerSettings defaultRequestHandlerSettings{};
-
-        defaultRequestHandlerSettings.registerRequestProcessor("/", {
-                                                                   { HttpMethod::GET, getProcess},
-                                                                   { HttpMethod::HEAD, headProcess}
-            });
-
-        DefaultRequestHandler requestHandler(defaultRequestHandlerSettings);
-
         executor.setProcessRequest([&requestHandler](const HttpRequest& request, HttpResponse& response) {
             return requestHandler.processRequest(request, response);
         });
@@ -8,3 +8,5 @@ include ("SimpleHTTP/SimpleHTTP")
 
 include ("SimpleHTTPTestbed/SimpleHTTPTestbed")
 
+include ("SimpleHTTPBenchmark/SimpleHTTPBenchmark")
+